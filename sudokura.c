@@ -0,0 +1,81 @@
+/*  libsudokura — C API over sudokura_core.h (see sudokura.h). No SDL.
+    Build:
+      static:  gcc -std=c11 -O2 -Wall -Wextra -c sudokura.c -o sudokura.o && ar rcs libsudokura.a sudokura.o
+      shared:  gcc -std=c11 -O2 -Wall -Wextra -fPIC -fvisibility=hidden -shared sudokura.c -o libsudokura.so
+      macOS:   clang -std=c11 -O2 -Wall -Wextra -fvisibility=hidden -dynamiclib sudokura.c -o libsudokura.dylib
+      Windows: gcc -std=c11 -O2 -Wall -Wextra -DSK_SHARED -shared sudokura.c -o sudokura.dll -Wl,--out-implib,libsudokura.dll.a
+               (define SK_SHARED when compiling code that uses the DLL)
+    License: GPLv3
+*/
+#define SK_BUILD
+#include "sudokura.h"
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"   /* pack writer / verifier are front-end only */
+#endif
+#include "sudokura_core.h"
+
+struct sk_ctx { Core core; };
+struct sk_game { Game g; };
+
+/* the API speaks int[81]; the core keeps one byte per cell */
+static bool grid_in(const int*g,uint8_t*out){ for(int i=0;i<81;i++){ if(g[i]<0||g[i]>9) return false; out[i]=(uint8_t)g[i]; } return true; }
+static void grid_out(const uint8_t*g,int*out){ for(int i=0;i<81;i++) out[i]=g[i]; }
+static bool cell_ok(const sk_game*g,int r,int c){ return r>=0 && r<g->g.side && c>=0 && c<g->g.side; }
+
+SK_API int sk_version(void){ return SK_VERSION_MAJOR<<16 | SK_VERSION_MINOR; }
+
+SK_API sk_ctx* sk_create(void){
+  sk_ctx* x=(sk_ctx*)malloc(sizeof(*x)); if(!x) return NULL;
+  core_init(&x->core); return x;
+}
+SK_API void sk_destroy(sk_ctx*x){ if(!x) return; core_free(&x->core); free(x); }
+SK_API int sk_set_solver(sk_ctx*x,const char*name){ return name && solver_select(&x->core,name)? 0 : -1; }
+SK_API int sk_set_simd(sk_ctx*x,const char*name){ return name && simd_select(&x->core,name)? 0 : -1; }
+SK_API int sk_set_difficulty(sk_ctx*x,const char*band){ return band && parse_band(band,&x->core.band)? 0 : -1; }
+SK_API int sk_open_pack(sk_ctx*x,const char*path,char*err,size_t errlen){
+  char buf[256]; Pack* p=pack_open(path,buf,sizeof(buf));
+  if(!p){ if(err && errlen) snprintf(err,errlen,"%s",buf); return -1; }
+  pack_close(x->core.pack); x->core.pack=p; return 0;
+}
+SK_API const char* sk_simd_name(const sk_ctx*x){ return mrv_name(x->core.find_mrv); }
+
+SK_API sk_rng sk_rng_make(uint64_t seed,uint64_t stream){ Rng r=rng_make(seed,stream); sk_rng o={ r.s }; return o; }
+
+SK_API int sk_count_solutions(const sk_ctx*x,const int puzzle[81],int limit,int first[81]){
+  uint8_t p[81], f[81]; if(!grid_in(puzzle,p)) return -1;
+  Board b; if(limit<1 || !board_load(&b,p)) return 0;
+  int n=solver_count(&x->core,&b,limit,first? f : NULL);
+  if(n && first) grid_out(f,first);
+  return n;
+}
+SK_API int sk_unique_solution(const sk_ctx*x,const int puzzle[81],int solution[81]){
+  uint8_t p[81], sol[81]; if(!grid_in(puzzle,p) || !unique_solution(&x->core,p,sol)) return 0;
+  if(solution) grid_out(sol,solution);
+  return 1;
+}
+SK_API int sk_grade(const int puzzle[81]){ uint8_t p[81]; return grid_in(puzzle,p)? (int)grade_puzzle(p) : SK_EXTREME; }
+SK_API const char* sk_difficulty_name(int d){ return d>=0 && d<5? DIFF_NAMES[d] : "unknown"; }
+SK_API uint64_t sk_canonical(const int puzzle[81],int canon[81]){
+  uint8_t p[81], c[81]; if(!grid_in(puzzle,p)) return 0;
+  uint64_t h=canonical_form(p,canon? c : NULL); if(canon) grid_out(c,canon);
+  return h;
+}
+SK_API int sk_generate(const sk_ctx*x,sk_rng*rng,int puzzle[81],int solution[81]){
+  uint8_t p[81], s[81]; Rng r={ rng->state }; Difficulty d=generate_puzzle(&x->core,&r,x->core.band,p,s); rng->state=r.s;
+  grid_out(p,puzzle); grid_out(s,solution);
+  return (int)d | (d<x->core.band.lo || d>x->core.band.hi? SK_OFF_BAND : 0);
+}
+
+SK_API sk_game* sk_game_new(const sk_ctx*x,sk_rng*rng){
+  sk_game* g=(sk_game*)malloc(sizeof(*g)); if(!g) return NULL;
+  Rng r={ rng->state }; new_game(&x->core,3,&g->g,&r); rng->state=r.s; return g;
+}
+SK_API void sk_game_free(sk_game*g){ free(g); }
+SK_API int sk_game_get(const sk_game*g,int r,int c){ return cell_ok(g,r,c)? g->g.puzzle[GIDX(&g->g,r,c)] : 0; }
+SK_API int sk_game_is_given(const sk_game*g,int r,int c){ return cell_ok(g,r,c) && game_fixed(&g->g,GIDX(&g->g,r,c)); }
+SK_API int sk_game_solution(const sk_game*g,int r,int c){ return cell_ok(g,r,c)? g->g.solution[GIDX(&g->g,r,c)] : 0; }
+SK_API int sk_game_place(sk_game*g,int r,int c,int v,int strict){ return cell_ok(g,r,c) && v>=0 && v<=g->g.side && place(&g->g,r,c,v,strict!=0); }
+SK_API int sk_game_hint(sk_game*g,int r,int c){ return cell_ok(g,r,c) && give_hint(&g->g,r,c); }
+SK_API int sk_game_conflicts(const sk_game*g){ return count_conflicts(&g->g); }
+SK_API int sk_game_solved(const sk_game*g){ return is_solved(&g->g); }
@@ -0,0 +1,87 @@
+/*  libsudokura — the Sudokura puzzle core as a C library (no SDL, no globals)
+    Generate, grade, solve and play 9x9 Sudoku. All state lives in an sk_ctx (solver backend,
+    SIMD kernel, difficulty band, optional puzzle pack) and an sk_rng you pass in explicitly.
+    Threads: an sk_ctx may be shared once configured (the sk_set_* / sk_open_pack calls are not
+    thread-safe); give each thread its own sk_rng. An sk_game belongs to one thread.
+    Grids are int[81] in row-major order, 0 = blank, 1..9 = digit.
+    License: GPLv3
+*/
+#ifndef SUDOKURA_H
+#define SUDOKURA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(SK_SHARED)
+  #ifdef SK_BUILD
+    #define SK_API __declspec(dllexport)
+  #else
+    #define SK_API __declspec(dllimport)
+  #endif
+#elif defined(__GNUC__) || defined(__clang__)
+  #define SK_API __attribute__((visibility("default")))
+#else
+  #define SK_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SK_VERSION_MAJOR 1
+#define SK_VERSION_MINOR 2
+
+typedef struct sk_ctx sk_ctx;
+typedef struct sk_game sk_game;
+typedef struct { uint64_t state; } sk_rng;
+
+typedef enum { SK_EASY=0, SK_MEDIUM=1, SK_HARD=2, SK_EXPERT=3, SK_EXTREME=4 } sk_difficulty;
+#define SK_OFF_BAND 0x100   /* or'ed into sk_generate's result when the grade misses the band */
+
+/* (major<<16)|minor of the library actually linked */
+SK_API int sk_version(void);
+
+/* ---- Context. Setters return 0 on success, -1 on an unknown/unsupported name. ---- */
+SK_API sk_ctx* sk_create(void);                                   /* NULL if out of memory */
+SK_API void sk_destroy(sk_ctx* ctx);
+SK_API int sk_set_solver(sk_ctx* ctx, const char* name);          /* "backtrack" (default) | "dlx" */
+SK_API int sk_set_simd(sk_ctx* ctx, const char* name);            /* "auto" (default) | "scalar" | "sse41" | "avx2" */
+SK_API int sk_set_difficulty(sk_ctx* ctx, const char* band);      /* "easy".."extreme" or a range "medium-hard" */
+SK_API int sk_open_pack(sk_ctx* ctx, const char* path, char* err, size_t errlen);  /* sk_game_new draws from it */
+SK_API const char* sk_simd_name(const sk_ctx* ctx);
+
+/* same (seed, stream) -> same puzzles, on any thread */
+SK_API sk_rng sk_rng_make(uint64_t seed, uint64_t stream);
+
+/* ---- Puzzles ---- */
+/* number of solutions, stopping at limit; the first one goes to first (may be NULL).
+   0 if the givens conflict, -1 if a cell is outside 0..9. */
+SK_API int sk_count_solutions(const sk_ctx* ctx, const int puzzle[81], int limit, int first[81]);
+/* 1 and the solution if the puzzle has exactly one, else 0 */
+SK_API int sk_unique_solution(const sk_ctx* ctx, const int puzzle[81], int solution[81]);
+/* hardest human technique needed (sk_difficulty); does not check uniqueness */
+SK_API int sk_grade(const int puzzle[81]);
+SK_API const char* sk_difficulty_name(int difficulty);
+/* minimal form under the Sudoku symmetries (transpose, band/stack/row/column swaps, digit
+   relabeling) into canon (may be NULL); returns its 64-bit hash, equal for isomorphic puzzles */
+SK_API uint64_t sk_canonical(const int puzzle[81], int canon[81]);
+/* a unique puzzle in the context's difficulty band; returns its grade, with SK_OFF_BAND set
+   if no puzzle in the band turned up within the sampling cap (the closest one is returned) */
+SK_API int sk_generate(const sk_ctx* ctx, sk_rng* rng, int puzzle[81], int solution[81]);
+
+/* ---- Games (rows/columns 0..8) ---- */
+SK_API sk_game* sk_game_new(const sk_ctx* ctx, sk_rng* rng);     /* from the pack if one is open, else generated */
+SK_API void sk_game_free(sk_game* game);
+SK_API int sk_game_get(const sk_game* game, int r, int c);       /* current digit, 0 = empty */
+SK_API int sk_game_is_given(const sk_game* game, int r, int c);
+SK_API int sk_game_solution(const sk_game* game, int r, int c);
+SK_API int sk_game_place(sk_game* game, int r, int c, int v, int strict);  /* v=0 clears; strict rejects rule conflicts */
+SK_API int sk_game_hint(sk_game* game, int r, int c);            /* 1 if the cell was filled/corrected */
+SK_API int sk_game_conflicts(const sk_game* game);               /* filled cells that break a rule */
+SK_API int sk_game_solved(const sk_game* game);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUDOKURA_H */
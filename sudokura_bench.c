@@ -0,0 +1,167 @@
+/*  sudokura-bench — headless benchmark for the Sudoku core (no SDL)
+    Runs find_mrv, count_limit, unique_solution and grade_puzzle over puzzle corpora
+    (bench/17clue.txt, bench/hard.txt by default) plus synthetic make_solved / dig_puzzle /
+    generate_puzzle runs, and prints JSON: throughput, nodes/s and p50/p99/max latency per op.
+    Build:
+      gcc -std=c11 -O2 -Wall -Wextra sudokura_bench.c -o sudokura-bench -lm
+    Run:
+      ./sudokura-bench [--corpus FILE]... [--gen N] [--reps R] [--seed S]
+                       [--difficulty D] [--solver backtrack|dlx] [--simd auto|scalar|sse41|avx2]
+*/
+
+#if !defined(_WIN32)
+  #ifndef _POSIX_C_SOURCE
+  #define _POSIX_C_SOURCE 200809L
+  #endif
+#endif
+
+#include <math.h>
+
+static unsigned long long bench_nodes;
+#define CORE_NODE_HOOK() (++bench_nodes)
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"   /* game/pack helpers the bench does not call */
+#endif
+#include "sudokura_core.h"
+
+/* =================== TIMING & STATS =================== */
+static double now_us(void){
+#if defined(_WIN32)
+  LARGE_INTEGER f,c; QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+  return (double)c.QuadPart*1e6/(double)f.QuadPart;
+#else
+  struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return ts.tv_sec*1e6 + ts.tv_nsec*1e-3;
+#endif
+}
+
+typedef struct {
+  char op[32], set[64];
+  double* us; size_t n, cap;
+  unsigned long long nodes;
+} Series;
+
+static void series_add(Series*s,double us){
+  if(s->n==s->cap){
+    size_t nc=s->cap? s->cap*2 : 256;
+    double* nu=(double*)realloc(s->us,nc*sizeof(double));
+    if(!nu){ fprintf(stderr,"out of memory\n"); exit(1); }
+    s->us=nu; s->cap=nc;
+  }
+  s->us[s->n++]=us;
+}
+static int cmp_double(const void*a,const void*b){ double x=*(const double*)a, y=*(const double*)b; return (x>y)-(x<y); }
+/* nearest-rank percentile of a sorted sample */
+static double pct(const double*v,size_t n,double q){ size_t k=(size_t)ceil(q*(double)n); return v[k? k-1 : 0]; }
+
+static void series_json(Series*s,FILE*out,bool last){
+  if(!s->n) return;
+  qsort(s->us,s->n,sizeof(double),cmp_double);
+  double tot=0; for(size_t i=0;i<s->n;i++) tot+=s->us[i];
+  fprintf(out,"    {\"op\": \"%s\", \"set\": \"%s\", \"count\": %zu, \"per_sec\": %.1f, \"nodes\": %llu, \"nodes_per_sec\": %.1f, "
+              "\"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}%s\n",
+          s->op, s->set, s->n, tot>0? s->n*1e6/tot : 0.0, s->nodes, tot>0? s->nodes*1e6/tot : 0.0,
+          tot/(double)s->n, pct(s->us,s->n,0.50), pct(s->us,s->n,0.99), s->us[s->n-1], last?"":",");
+}
+
+/* =================== CORPORA =================== */
+/* one puzzle per line (81 chars, . or 0 = blank); '#' lines are comments */
+static int load_corpus(const char*path,uint8_t (**out)[81]){
+  FILE* f=fopen(path,"r"); if(!f) return -1;
+  uint8_t (*p)[81]=NULL; int n=0, cap=0; char line[256];
+  while(fgets(line,sizeof(line),f)){
+    if(line[0]=='#' || strlen(line)<81) continue;
+    if(n==cap){ cap=cap? cap*2 : 64; uint8_t (*np)[81]=realloc(p,sizeof(*p)*(size_t)cap); if(!np) break; p=np; }
+    bool ok=true;
+    for(int i=0;i<81;i++){ char c=line[i]; if(c=='.'||c=='0') p[n][i]=0; else if(c>='1'&&c<='9') p[n][i]=(uint8_t)(c-'0'); else ok=false; }
+    if(ok) n++;
+  }
+  fclose(f); *out=p; return n;
+}
+static void set_name(char out[64],const char*path){
+  const char* b=path; for(const char* q=path;*q;q++) if(*q=='/'||*q=='\\') b=q+1;
+  snprintf(out,64,"%s",b); char* dot=strrchr(out,'.'); if(dot && dot!=out) *dot=0;
+}
+
+/* =================== RUNS =================== */
+#define MAX_SERIES 64
+static Series series[MAX_SERIES]; static int nseries=0;
+static Series* series_new(const char*op,const char*set){
+  if(nseries==MAX_SERIES){ fprintf(stderr,"too many series\n"); exit(1); }
+  Series* s=&series[nseries++]; memset(s,0,sizeof(*s));
+  snprintf(s->op,sizeof(s->op),"%s",op); snprintf(s->set,sizeof(s->set),"%s",set); return s;
+}
+
+static void bench_corpus(const Core*core,const char*set,uint8_t (*puz)[81],int n,int reps){
+  Series *mrv=series_new("find_mrv",set), *cnt=series_new("count_limit",set),
+         *uni=series_new("unique_solution",set), *grd=series_new("grade_puzzle",set);
+  for(int r=0;r<reps;r++) for(int k=0;k<n;k++){
+    Board b; if(!board_load(&b,puz[k])) continue;
+    unsigned m; double t0=now_us(); volatile int i=core->find_mrv(&b,&m); series_add(mrv,now_us()-t0); (void)i;
+
+    Board t=b; bench_nodes=0; t0=now_us(); count_limit(core->find_mrv,&t,2,NULL); series_add(cnt,now_us()-t0); cnt->nodes+=bench_nodes;
+
+    uint8_t sol[81]; bench_nodes=0; t0=now_us(); unique_solution(core,puz[k],sol); series_add(uni,now_us()-t0); uni->nodes+=bench_nodes;
+
+    t0=now_us(); volatile Difficulty d=grade_puzzle(puz[k]); series_add(grd,now_us()-t0); (void)d;
+  }
+}
+
+static void bench_generate(const Core*core,int n,uint64_t seed,DiffBand band){
+  Series *ms=series_new("make_solved","synthetic"), *dig=series_new("dig_puzzle","synthetic"),
+         *gen=series_new("generate_puzzle","synthetic");
+  snprintf(gen->set,sizeof(gen->set),"synthetic-%s",DIFF_NAMES[band.lo]);
+  if(band.hi!=band.lo) snprintf(gen->set+strlen(gen->set),sizeof(gen->set)-strlen(gen->set),"-%s",DIFF_NAMES[band.hi]);
+  for(int k=0;k<n;k++){
+    Rng rng=rng_make(seed,(uint64_t)k);
+    uint8_t grid[81]; double t0=now_us(); make_solved(&rng,grid); series_add(ms,now_us()-t0);
+    bench_nodes=0; t0=now_us(); dig_puzzle(core,&rng,grid); series_add(dig,now_us()-t0); dig->nodes+=bench_nodes;
+  }
+  for(int k=0;k<n;k++){
+    Rng rng=rng_make(seed^0xB5ull,(uint64_t)k);
+    uint8_t puz[81], sol[81]; bench_nodes=0; double t0=now_us(); generate_puzzle(core,&rng,band,puz,sol); series_add(gen,now_us()-t0); gen->nodes+=bench_nodes;
+  }
+}
+
+/* "--opt=value" or "--opt value"; NULL if argv[*i] is not opt */
+static const char* arg_value(const char*opt,int argc,char**argv,int*i){
+  size_t n=strlen(opt);
+  if(strncmp(argv[*i],opt,n)) return NULL;
+  if(argv[*i][n]=='=') return argv[*i]+n+1;
+  if(argv[*i][n]==0) return (*i+1<argc)? argv[++*i] : "";
+  return NULL;
+}
+
+int main(int argc,char**argv){
+  const char* corpora[16]; int ncorp=0; int gen_n=200, reps=3; uint64_t seed=1;
+  const char* solver="backtrack"; const char* val;
+  Core core; core_init(&core);
+  for(int i=1;i<argc;i++){
+    if((val=arg_value("--corpus",argc,argv,&i))){ if(ncorp<16) corpora[ncorp++]=val; }
+    else if((val=arg_value("--gen",argc,argv,&i))) gen_n=atoi(val);
+    else if((val=arg_value("--reps",argc,argv,&i))) reps=atoi(val);
+    else if((val=arg_value("--seed",argc,argv,&i))) seed=strtoull(val,NULL,10);
+    else if((val=arg_value("--difficulty",argc,argv,&i))){ if(!parse_band(val,&core.band)){ fprintf(stderr,"Unknown difficulty '%s'\n",val); return 1; } }
+    else if((val=arg_value("--solver",argc,argv,&i))){ if(!solver_select(&core,val)){ fprintf(stderr,"Unknown solver '%s'\n",val); return 1; } solver=val; }
+    else if((val=arg_value("--simd",argc,argv,&i))){ if(!simd_select(&core,val)){ fprintf(stderr,"SIMD kernel '%s' unknown or unsupported\n",val); return 1; } }
+    else{ fprintf(stderr,"Unknown option %s\n",argv[i]); return 1; }
+  }
+  if(!ncorp){ corpora[ncorp++]="bench/17clue.txt"; corpora[ncorp++]="bench/hard.txt"; }
+
+  for(int c=0;c<ncorp;c++){
+    uint8_t (*puz)[81]=NULL; int n=load_corpus(corpora[c],&puz);
+    if(n<0){ fprintf(stderr,"cannot open corpus %s (skipped)\n",corpora[c]); continue; }
+    char set[64]; set_name(set,corpora[c]);
+    fprintf(stderr,"%s: %d puzzles x %d reps\n",set,n,reps);
+    bench_corpus(&core,set,puz,n,reps);
+    free(puz);
+  }
+  if(gen_n>0){ fprintf(stderr,"synthetic: %d grids\n",gen_n); bench_generate(&core,gen_n,seed,core.band); }
+
+  printf("{\n  \"solver\": \"%s\", \"simd\": \"%s\", \"reps\": %d, \"seed\": %llu,\n  \"results\": [\n",
+         solver, mrv_name(core.find_mrv), reps, (unsigned long long)seed);
+  int last=nseries-1; while(last>=0 && !series[last].n) last--;
+  for(int i=0;i<nseries;i++){ series_json(&series[i],stdout,i==last); free(series[i].us); }
+  printf("  ]\n}\n");
+  core_free(&core);
+  return 0;
+}
@@ -0,0 +1,1082 @@
+/*  Sudokura core — board, solvers (bitboard backtracker, DLX, SIMD MRV), difficulty grader,
+    generator and memory-mapped puzzle packs. No SDL.
+    Header-only: include it from one translation unit (sudokura_sdl.c, sudokura_bench.c, sudokura.c).
+    No globals: configuration is a Core passed to every entry point, randomness an explicit Rng.
+    License: GPLv3
+*/
+#ifndef SUDOKURA_CORE_H
+#define SUDOKURA_CORE_H
+
+#if !defined(_WIN32)
+  #ifndef _POSIX_C_SOURCE
+  #define _POSIX_C_SOURCE 200809L
+  #endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+/* called once per search node by count_limit and the DLX search (sudokura_bench counts nodes) */
+#ifndef CORE_NODE_HOOK
+#define CORE_NODE_HOOK() ((void)0)
+#endif
+
+/* =================== SUDOKU CORE =================== */
+#define N 9
+#define NN (N*N)
+static inline int IDX(int r,int c){ return r*N + c; }
+
+/* a game can be 4x4, 9x9, 16x16 or 25x25 (box 2..5); the solver core below is 9x9 */
+#define MAX_BOX   5
+#define MAX_SIDE  (MAX_BOX*MAX_BOX)
+#define MAX_CELLS (MAX_SIDE*MAX_SIDE)
+typedef struct {
+  int box, side;                 /* 3 and 9 for the classic board */
+  uint8_t puzzle[MAX_CELLS];      /* one byte per cell: digits never exceed MAX_SIDE */
+  uint8_t solution[MAX_CELLS];
+  uint64_t fixed[(MAX_CELLS+63)/64];   /* givens, one bit per cell (game_fixed) */
+  uint32_t notes[MAX_CELLS];     /* bitmask: bit v (1..side) */
+  /* kept in sync by game_set: occurrences of each digit per row/col/box, and the cells
+     whose digit repeats in one of their units (conflicts = popcount of that bitset) */
+  uint8_t unit_cnt[3][MAX_SIDE][MAX_SIDE+1];
+  uint32_t unit_mask[3][MAX_SIDE];   /* bit v set while digit v occurs in the row/col/box */
+  uint64_t conflict[(MAX_CELLS+63)/64];
+  int conflicts;
+} Game;
+static inline int GIDX(const Game*g,int r,int c){ return r*g->side + c; }
+static inline bool game_fixed(const Game*g,int i){ return (g->fixed[i>>6]>>(i&63))&1; }
+
+/* explicit PRNG state (splitmix64) so generation can run on several threads */
+typedef struct { uint64_t s; } Rng;
+static inline uint64_t mix64(uint64_t z){
+  z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull; return z^(z>>31);
+}
+static inline Rng rng_make(uint64_t seed,uint64_t stream){ Rng r={ mix64(seed + mix64(stream + 0x9E3779B97F4A7C15ull)) }; return r; }
+static inline uint64_t rng_next(Rng*r){ r->s += 0x9E3779B97F4A7C15ull; return mix64(r->s); }
+static inline int rng_below(Rng*r,int n){ return (int)(rng_next(r) % (uint64_t)n); }
+static void shuffle(Rng*rng,int *a,int n){ for(int i=n-1;i>0;--i){ int j=rng_below(rng,i+1); int t=a[i]; a[i]=a[j]; a[j]=t; } }
+
+/* ---- Solver core: bitboards (per-row/col/box digit masks, bit v = digit v like notes) ---- */
+#define ALL_DIGITS 0x3FEu
+typedef struct {
+  uint16_t row[N], col[N], box[N];
+  uint8_t cell[NN];   /* 0 = empty; 135 bytes per board, so search snapshots stay cheap */
+} Board;
+
+static inline int BOX(int r,int c){ return (r/3)*3 + c/3; }
+static inline int popcnt16(unsigned x){
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcount(x);
+#else
+  x = x - ((x>>1)&0x5555u); x = (x&0x3333u) + ((x>>2)&0x3333u); x = (x + (x>>4)) & 0x0F0Fu; return (int)((x + (x>>8)) & 0x1Fu);
+#endif
+}
+static inline int lowbit16(unsigned x){
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(x);
+#else
+  int v=0; while(!(x&1u)){ x>>=1; v++; } return v;
+#endif
+}
+static inline int popcnt32(uint32_t x){
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcount(x);
+#else
+  x = x - ((x>>1)&0x55555555u); x = (x&0x33333333u) + ((x>>2)&0x33333333u); x = (x + (x>>4)) & 0x0F0F0F0Fu; return (int)((x*0x01010101u)>>24);
+#endif
+}
+static inline int lowbit32(uint32_t x){ return lowbit16(x); }
+static inline unsigned board_cand(const Board*b,int i){
+  int r=i/9,c=i%9; return ALL_DIGITS & ~(unsigned)(b->row[r]|b->col[c]|b->box[BOX(r,c)]);
+}
+static inline void board_set(Board*b,int i,int v){
+  int r=i/9,c=i%9; uint16_t m=(uint16_t)(1u<<v);
+  b->cell[i]=(uint8_t)v; b->row[r]|=m; b->col[c]|=m; b->box[BOX(r,c)]|=m;
+}
+static inline void board_unset(Board*b,int i){
+  int r=i/9,c=i%9; uint16_t m=(uint16_t)~(1u<<b->cell[i]);
+  b->cell[i]=0; b->row[r]&=m; b->col[c]&=m; b->box[BOX(r,c)]&=m;
+}
+/* false if a given is out of range or repeats in its row/col/box */
+static bool board_load(Board*b,const uint8_t*grid){
+  memset(b,0,sizeof(*b));
+  for(int i=0;i<81;i++){
+    int v=grid[i]; if(!v) continue;
+    if(v<1||v>9||!(board_cand(b,i)&(1u<<v))) return false;
+    board_set(b,i,v);
+  }
+  return true;
+}
+
+/* ---- MRV kernels: first empty cell with the fewest candidates (0 and 1 both stop the scan,
+   so every kernel picks the same cell); -1 if the board is full ---- */
+static int find_mrv_scalar(const Board*b,unsigned*cand){
+  int best=-1, bc=10; unsigned bm=0;
+  for(int i=0;i<81;i++){
+    if(b->cell[i]) continue;
+    unsigned m=board_cand(b,i); int cnt=popcnt16(m);
+    if(cnt<bc){ bc=cnt; best=i; bm=m; if(cnt<=1) break; }
+  }
+  *cand=bm; return best;
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MRV_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define TARGET_SSE41
+  #define TARGET_AVX2
+#else
+  #define TARGET_SSE41 __attribute__((target("sse4.1")))
+  #define TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+/* packed board: used-digit mask per cell (row|col|box), 9 lanes per row, padding lanes full */
+TARGET_SSE41 static inline void mrv_expand(const Board*b,uint16_t used[96]){
+  __m128i colv=_mm_loadu_si128((const __m128i*)b->col);
+  for(int k=0;k<3;k++){
+    short b0=(short)b->box[3*k], b1=(short)b->box[3*k+1], b2=(short)b->box[3*k+2];
+    __m128i cb=_mm_or_si128(colv,_mm_setr_epi16(b0,b0,b0,b1,b1,b1,b2,b2));
+    uint16_t last=(uint16_t)(b->col[8]|b->box[3*k+2]);
+    for(int rr=0;rr<3;rr++){
+      int r=3*k+rr;
+      _mm_storeu_si128((__m128i*)(used+9*r),_mm_or_si128(cb,_mm_set1_epi16((short)b->row[r])));
+      used[9*r+8]=(uint16_t)(last|b->row[r]);
+    }
+  }
+  for(int i=81;i<96;i++) used[i]=0xFFFF;
+}
+/* 0xFFFF lanes for filled cells (and padding), 0 for empty ones */
+TARGET_SSE41 static inline __m128i mrv_filled8(const Board*b,int k){
+  if(k>=80) return _mm_setr_epi16(b->cell[80]?-1:0,-1,-1,-1,-1,-1,-1,-1);
+  __m128i e=_mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i*)(b->cell+k)),_mm_setzero_si128());
+  return _mm_xor_si128(_mm_unpacklo_epi8(e,e),_mm_set1_epi16(-1));
+}
+/* per-lane key: popcount of candidates clamped to >=1, 0xFFFF where filled */
+TARGET_SSE41 static inline __m128i mrv_keys8(__m128i used,__m128i filled){
+  const __m128i lut=_mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4), low4=_mm_set1_epi8(0x0F);
+  __m128i m=_mm_andnot_si128(used,_mm_set1_epi16((short)ALL_DIGITS));
+  __m128i pc=_mm_add_epi8(_mm_shuffle_epi8(lut,_mm_and_si128(m,low4)),_mm_shuffle_epi8(lut,_mm_and_si128(_mm_srli_epi16(m,4),low4)));
+  pc=_mm_add_epi16(_mm_and_si128(pc,_mm_set1_epi16(0xFF)),_mm_srli_epi16(pc,8));
+  return _mm_or_si128(_mm_max_epu16(pc,_mm_set1_epi16(1)),filled);
+}
+TARGET_SSE41 static int find_mrv_sse41(const Board*b,unsigned*cand){
+  uint16_t used[96]; mrv_expand(b,used);
+  unsigned best=0xFFFF; int bi=-1;
+  for(int k=0;k<88;k+=8){
+    __m128i key=mrv_keys8(_mm_loadu_si128((const __m128i*)(used+k)),mrv_filled8(b,k));
+    unsigned r=(unsigned)_mm_cvtsi128_si32(_mm_minpos_epu16(key)), mn=r&0xFFFF;
+    if(mn<best){ best=mn; bi=k+(int)((r>>16)&7); if(mn==1) break; }
+  }
+  if(bi<0){ *cand=0; return -1; }
+  *cand=board_cand(b,bi); return bi;
+}
+TARGET_AVX2 static int find_mrv_avx2(const Board*b,unsigned*cand){
+  uint16_t used[96]; mrv_expand(b,used);
+  const __m256i lut=_mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+  const __m256i low4=_mm256_set1_epi8(0x0F), all=_mm256_set1_epi16((short)ALL_DIGITS);
+  unsigned best=0xFFFF; int bi=-1;
+  for(int k=0;k<96;k+=16){
+    __m256i m=_mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(used+k)),all);
+    __m256i pc=_mm256_add_epi8(_mm256_shuffle_epi8(lut,_mm256_and_si256(m,low4)),_mm256_shuffle_epi8(lut,_mm256_and_si256(_mm256_srli_epi16(m,4),low4)));
+    pc=_mm256_add_epi16(_mm256_and_si256(pc,_mm256_set1_epi16(0xFF)),_mm256_srli_epi16(pc,8));
+    pc=_mm256_max_epu16(pc,_mm256_set1_epi16(1));
+    __m256i filled;
+    if(k<80){
+      __m128i e=_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(b->cell+k)),_mm_setzero_si128());
+      filled=_mm256_xor_si256(_mm256_cvtepi8_epi16(e),_mm256_set1_epi16(-1));
+    }else filled=_mm256_setr_epi16(b->cell[80]?-1:0,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+    __m256i key=_mm256_or_si256(pc,filled);
+    for(int h=0;h<2;h++){
+      __m128i kh=h?_mm256_extracti128_si256(key,1):_mm256_castsi256_si128(key);
+      unsigned r=(unsigned)_mm_cvtsi128_si32(_mm_minpos_epu16(kh)), mn=r&0xFFFF;
+      if(mn<best){ best=mn; bi=k+8*h+(int)((r>>16)&7); if(mn==1) goto done; }
+    }
+  }
+done:
+  if(bi<0){ *cand=0; return -1; }
+  *cand=board_cand(b,bi); return bi;
+}
+/* 0 scalar, 1 SSE4.1, 2 AVX2 */
+static int cpu_simd_level(void){
+#if defined(_MSC_VER) && !defined(__clang__)
+  int r[4]; __cpuid(r,1);
+  bool sse41=(r[2]>>19)&1, osxsave=(r[2]>>27)&1, avx=(r[2]>>28)&1;
+  if(osxsave && avx && (_xgetbv(0)&6)==6){ __cpuidex(r,7,0); if((r[1]>>5)&1) return 2; }
+  return sse41?1:0;
+#else
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) return 2;
+  return __builtin_cpu_supports("sse4.1")?1:0;
+#endif
+}
+#endif /* x86 */
+
+/* ---- Kernel selection (--simd=auto|scalar|sse41|avx2) ---- */
+typedef int (*MrvFn)(const Board*,unsigned*);
+
+/* NULL if the name is unknown or the CPU lacks the instructions */
+static MrvFn mrv_lookup(const char*name){
+  int have=0;
+#ifdef MRV_X86
+  have=cpu_simd_level();
+#endif
+  int want = !strcmp(name,"auto")?have : !strcmp(name,"scalar")?0 : !strcmp(name,"sse41")?1 : !strcmp(name,"avx2")?2 : -1;
+  if(want<0 || want>have) return NULL;
+#ifdef MRV_X86
+  if(want==1) return find_mrv_sse41;
+  if(want==2) return find_mrv_avx2;
+#endif
+  return find_mrv_scalar;
+}
+
+static const char* mrv_name(MrvFn f){
+#ifdef MRV_X86
+  if(f==find_mrv_sse41) return "sse41";
+  if(f==find_mrv_avx2) return "avx2";
+#endif
+  (void)f; return "scalar";
+}
+
+/* counts solutions up to limit; the first one found is copied to first (may be NULL) */
+static int count_limit(MrvFn mrv,Board*b,int limit,uint8_t*first){
+  unsigned m; int i=mrv(b,&m); if(i<0){ if(first) memcpy(first,b->cell,81); return 1; }
+  int tot=0;
+  while(m){
+    int v=lowbit16(m); m&=m-1; board_set(b,i,v); CORE_NODE_HOOK();
+    tot+=count_limit(mrv,b,limit-tot,tot?NULL:first); board_unset(b,i);
+    if(tot>=limit) return tot;
+  }
+  return tot;
+}
+/* ---- Dancing Links (Algorithm X) backend: 324 constraint columns, 729 candidate rows ---- */
+#define DLX_COLS  324                  /* cell, row-digit, col-digit, box-digit */
+#define DLX_NODES (1+DLX_COLS+729*4)   /* root + headers + 4 nodes per candidate */
+typedef struct {
+  uint16_t L[DLX_NODES], R[DLX_NODES], U[DLX_NODES], D[DLX_NODES], C[DLX_NODES], row[DLX_NODES];
+  uint16_t size[DLX_COLS+1];
+  uint8_t cell[NN];                    /* givens + current partial solution */
+} Dlx;
+
+/* full matrix; built once per Core, every search copies it */
+static void dlx_build(Dlx*x){
+  memset(x,0,sizeof(*x));
+  for(int c=0;c<=DLX_COLS;c++){ x->L[c]=(uint16_t)(c?c-1:DLX_COLS); x->R[c]=(uint16_t)(c<DLX_COLS?c+1:0); x->U[c]=x->D[c]=(uint16_t)c; x->C[c]=(uint16_t)c; }
+  int n=DLX_COLS+1;
+  for(int i=0;i<81;i++) for(int d=0;d<9;d++){
+    int r=i/9,c=i%9;
+    int cols[4]={ 1+i, 1+81+r*9+d, 1+162+c*9+d, 1+243+BOX(r,c)*9+d };
+    for(int k=0;k<4;k++){
+      int col=cols[k], nd=n+k;
+      x->C[nd]=(uint16_t)col; x->row[nd]=(uint16_t)(i*9+d);
+      x->U[nd]=x->U[col]; x->D[nd]=(uint16_t)col; x->D[x->U[col]]=(uint16_t)nd; x->U[col]=(uint16_t)nd; x->size[col]++;
+      x->L[nd]=(uint16_t)(n+(k+3)%4); x->R[nd]=(uint16_t)(n+(k+1)%4);
+    }
+    n+=4;
+  }
+}
+static inline void dlx_cover(Dlx*x,int c){
+  x->R[x->L[c]]=x->R[c]; x->L[x->R[c]]=x->L[c];
+  for(int i=x->D[c];i!=c;i=x->D[i]) for(int j=x->R[i];j!=i;j=x->R[j]){
+    x->D[x->U[j]]=x->D[j]; x->U[x->D[j]]=x->U[j]; x->size[x->C[j]]--;
+  }
+}
+static inline void dlx_uncover(Dlx*x,int c){
+  for(int i=x->U[c];i!=c;i=x->U[i]) for(int j=x->L[i];j!=i;j=x->L[j]){
+    x->size[x->C[j]]++; x->D[x->U[j]]=(uint16_t)j; x->U[x->D[j]]=(uint16_t)j;
+  }
+  x->R[x->L[c]]=(uint16_t)c; x->L[x->R[c]]=(uint16_t)c;
+}
+static int dlx_search(Dlx*x,int limit,uint8_t*first){
+  if(x->R[0]==0){ if(first) memcpy(first,x->cell,81); return 1; }
+  int c=x->R[0];
+  for(int j=x->R[c];j!=0;j=x->R[j]) if(x->size[j]<x->size[c]){ c=j; if(x->size[c]<=1) break; }
+  if(x->size[c]==0) return 0;
+  dlx_cover(x,c);
+  int tot=0;
+  for(int r=x->D[c];r!=c && tot<limit;r=x->D[r]){
+    x->cell[x->row[r]/9]=(uint8_t)(x->row[r]%9+1); CORE_NODE_HOOK();
+    for(int j=x->R[r];j!=r;j=x->R[j]) dlx_cover(x,x->C[j]);
+    tot+=dlx_search(x,limit-tot,tot?NULL:first);
+    for(int j=x->L[r];j!=r;j=x->L[j]) dlx_uncover(x,x->C[j]);
+    x->cell[x->row[r]/9]=0;
+  }
+  dlx_uncover(x,c);
+  return tot;
+}
+/* same contract as count_limit; givens are pre-selected rows of the matrix */
+static int dlx_count(const Dlx*tmpl,const uint8_t*grid,int limit,uint8_t*first){
+  Dlx x=*tmpl;
+  for(int i=0;i<81;i++){
+    int v=grid[i]; if(!v) continue;
+    int nd=DLX_COLS+1+(i*9+v-1)*4;
+    for(int k=0;k<4;k++){ int col=x.C[nd+k]; if(x.L[x.R[col]]!=col) return 0; } /* column already covered: conflict */
+    for(int k=0;k<4;k++) dlx_cover(&x,x.C[nd+k]);
+    x.cell[i]=(uint8_t)v;
+  }
+  return dlx_search(&x,limit,first);
+}
+
+/* ---- Core context: everything the entry points used to read from globals.
+   Configure it up front; it is only read while searching, so threads may share one. ---- */
+typedef enum { SOLVER_BACKTRACK=0, SOLVER_DLX=1 } SolverKind;
+typedef enum { DIFF_EASY=0, DIFF_MEDIUM=1, DIFF_HARD=2, DIFF_EXPERT=3, DIFF_EXTREME=4 } Difficulty;
+typedef struct { Difficulty lo, hi; } DiffBand;
+static const char* const DIFF_NAMES[]={"easy","medium","hard","expert","extreme"};
+struct Pack;
+
+typedef struct {
+  SolverKind solver; Dlx* dlx;   /* dlx: matrix template, built when the DLX backend is chosen */
+  MrvFn find_mrv;                /* --simd */
+  DiffBand band;                 /* --difficulty, for new_game */
+  struct Pack* pack;             /* --pack: new_game draws from it when set (owned) */
+  bool minimal;                  /* --minimal: dig until no single clue can be removed */
+  /* optional: run fn(arg,k) for k in [0,n) on other threads and return when all are done
+     (NULL: a plain loop). Used by the minimal digger; results never depend on the order. */
+  void (*parallel_for)(void*pool,int n,void (*fn)(void*arg,int k),void*arg);
+  void* pool;
+} Core;
+
+static void core_init(Core*c){
+  memset(c,0,sizeof(*c));
+  c->solver=SOLVER_BACKTRACK; c->find_mrv=mrv_lookup("auto");
+  c->band.lo=c->band.hi=DIFF_MEDIUM;
+}
+/* --solver=backtrack|dlx */
+static bool solver_select(Core*c,const char*name){
+  if(!strcmp(name,"backtrack")){ c->solver=SOLVER_BACKTRACK; return true; }
+  if(strcmp(name,"dlx")) return false;
+  if(!c->dlx){ c->dlx=(Dlx*)malloc(sizeof(Dlx)); if(!c->dlx) return false; dlx_build(c->dlx); }
+  c->solver=SOLVER_DLX; return true;
+}
+static bool simd_select(Core*c,const char*name){ MrvFn f=mrv_lookup(name); if(f) c->find_mrv=f; return f!=NULL; }
+
+static int solver_count(const Core*c,const Board*b,int limit,uint8_t*first){
+  if(c->solver==SOLVER_DLX) return dlx_count(c->dlx,b->cell,limit,first);
+  Board t=*b; return count_limit(c->find_mrv,&t,limit,first);
+}
+/* one search: stops at the second solution, keeps the first in out_sol */
+static bool unique_solution(const Core*c,const uint8_t*puz,uint8_t*out_sol){
+  Board b; if(!board_load(&b,puz)) return false;
+  return solver_count(c,&b,2,out_sol)==1;
+}
+
+/* ---- Difficulty grader: human techniques on a bitmask candidate grid, cheapest first.
+   A puzzle is rated by the hardest technique it needs; no allocation per step. ---- */
+
+typedef struct {
+  uint16_t cand[NN];  /* 0 once the cell is solved */
+  uint8_t cell[NN]; int left;
+  bool broken;        /* a cell ran out of candidates */
+} Grader;
+
+/* unit u: rows 0..8, cols 9..17, boxes 18..26 */
+static inline int unit_cell(int u,int k){
+  if(u<9) return u*9+k;
+  if(u<18) return k*9+(u-9);
+  int b=u-18; return ((b/3)*3 + k/3)*9 + (b%3)*3 + k%3;
+}
+static void grader_place(Grader*g,int i,int v){
+  int r=i/9,c=i%9,b=BOX(r,c); uint16_t m=(uint16_t)~(1u<<v);
+  g->cell[i]=(uint8_t)v; g->cand[i]=0; g->left--;
+  for(int k=0;k<9;k++){ g->cand[unit_cell(r,k)]&=m; g->cand[unit_cell(9+c,k)]&=m; g->cand[unit_cell(18+b,k)]&=m; }
+}
+static bool grader_init(Grader*g,const uint8_t*puz){
+  Board b; if(!board_load(&b,puz)) return false;
+  g->left=0; g->broken=false;
+  for(int i=0;i<81;i++){ g->cell[i]=b.cell[i]; g->cand[i]=b.cell[i]? 0 : (uint16_t)board_cand(&b,i); if(!b.cell[i]) g->left++; }
+  return true;
+}
+/* clear digits dm from cell i; true if anything changed */
+static inline bool grader_elim(Grader*g,int i,unsigned dm){
+  if(!(g->cand[i]&dm)) return false;
+  g->cand[i]&=(uint16_t)~dm; if(!g->cand[i]) g->broken=true; return true;
+}
+
+static bool tech_naked_single(Grader*g){
+  bool any=false;
+  for(int i=0;i<81;i++){
+    if(g->cell[i]) continue;
+    unsigned m=g->cand[i]; if(!m){ g->broken=true; return false; }
+    if(!(m&(m-1))){ grader_place(g,i,lowbit16(m)); any=true; }
+  }
+  return any;
+}
+static bool tech_hidden_single(Grader*g){
+  bool any=false;
+  for(int u=0;u<27;u++){
+    unsigned once=0, twice=0;
+    for(int k=0;k<9;k++){ unsigned m=g->cand[unit_cell(u,k)]; twice|=once&m; once|=m; }
+    unsigned only=once&~twice;
+    while(only){
+      int v=lowbit16(only); only&=only-1;
+      for(int k=0;k<9;k++){ int i=unit_cell(u,k); if(g->cand[i]&(1u<<v)){ grader_place(g,i,v); any=true; break; } }
+    }
+  }
+  return any;
+}
+/* pointing (box -> line) and claiming (line -> box) */
+static bool tech_locked(Grader*g){
+  bool any=false;
+  for(int b=0;b<9;b++) for(int v=1;v<=9;v++){
+    unsigned dm=1u<<v, rows=0, cols=0;
+    for(int k=0;k<9;k++) if(g->cand[unit_cell(18+b,k)]&dm){ rows|=1u<<(k/3); cols|=1u<<(k%3); }
+    int r0=(b/3)*3, c0=(b%3)*3;
+    if(rows && !(rows&(rows-1))){ int r=r0+lowbit16(rows); for(int c=0;c<9;c++) if(c/3!=b%3) any|=grader_elim(g,r*9+c,dm); }
+    if(cols && !(cols&(cols-1))){ int c=c0+lowbit16(cols); for(int r=0;r<9;r++) if(r/3!=b/3) any|=grader_elim(g,r*9+c,dm); }
+  }
+  for(int u=0;u<18;u++) for(int v=1;v<=9;v++){
+    unsigned dm=1u<<v; int box=-1; bool one=true;
+    for(int k=0;k<9 && one;k++){ int i=unit_cell(u,k); if(g->cand[i]&dm){ int bb=BOX(i/9,i%9); if(box<0) box=bb; else if(bb!=box) one=false; } }
+    if(!one || box<0) continue;
+    for(int k=0;k<9;k++){ int i=unit_cell(18+box,k); bool in_line = u<9 ? i/9==u : i%9==u-9; if(!in_line) any|=grader_elim(g,i,dm); }
+  }
+  return any;
+}
+/* naked subset of size n: n cells of a unit whose candidates span n digits */
+static bool naked_subset(Grader*g,int n){
+  bool any=false;
+  for(int u=0;u<27;u++){
+    int idx[9], e=0;
+    for(int k=0;k<9;k++){ int i=unit_cell(u,k); if(!g->cell[i]) idx[e++]=i; }
+    if(e<=n) continue;
+    for(int a=0;a<e;a++) for(int b=a+1;b<e;b++) for(int c=(n>2?b+1:e-1);c<e;c++){
+      unsigned un=g->cand[idx[a]]|g->cand[idx[b]]|(n>2?g->cand[idx[c]]:0u);
+      if(popcnt16(un)!=n) continue;
+      for(int k=0;k<e;k++) if(k!=a && k!=b && (n<3 || k!=c)) any|=grader_elim(g,idx[k],un);
+      if(n<3) break;
+    }
+  }
+  return any;
+}
+/* hidden subset of size n: n digits confined to the same n cells of a unit */
+static bool hidden_subset(Grader*g,int n){
+  bool any=false;
+  for(int u=0;u<27;u++){
+    unsigned pos[10]={0}; int dig[9], d=0;
+    for(int k=0;k<9;k++){ unsigned m=g->cand[unit_cell(u,k)]; while(m){ int v=lowbit16(m); m&=m-1; pos[v]|=1u<<k; } }
+    for(int v=1;v<=9;v++) if(pos[v] && popcnt16(pos[v])<=n) dig[d++]=v;
+    for(int a=0;a<d;a++) for(int b=a+1;b<d;b++) for(int c=(n>2?b+1:d-1);c<d;c++){
+      unsigned cells=pos[dig[a]]|pos[dig[b]]|(n>2?pos[dig[c]]:0u);
+      unsigned keep=(1u<<dig[a])|(1u<<dig[b])|(n>2?1u<<dig[c]:0u);
+      if(popcnt16(cells)!=n) continue;
+      for(int k=0;k<9;k++) if(cells&(1u<<k)) any|=grader_elim(g,unit_cell(u,k),ALL_DIGITS&~keep);
+      if(n<3) break;
+    }
+  }
+  return any;
+}
+/* basic fish of size n (2 = X-Wing, 3 = Swordfish), rows then columns as base */
+static bool fish(Grader*g,int n){
+  bool any=false;
+  for(int v=1;v<=9;v++) for(int t=0;t<2;t++){
+    unsigned dm=1u<<v, line[9]; int base[9], nb=0;
+    for(int a=0;a<9;a++){
+      line[a]=0; for(int k=0;k<9;k++) if(g->cand[t? k*9+a : a*9+k]&dm) line[a]|=1u<<k;
+      int pc=popcnt16(line[a]); if(pc>=2 && pc<=n) base[nb++]=a;
+    }
+    for(int a=0;a<nb;a++) for(int b=a+1;b<nb;b++) for(int c=(n>2?b+1:nb-1);c<nb;c++){
+      unsigned cover=line[base[a]]|line[base[b]]|(n>2?line[base[c]]:0u);
+      if(popcnt16(cover)!=n) continue;
+      for(int o=0;o<9;o++){
+        if(o==base[a] || o==base[b] || (n>2 && o==base[c])) continue;
+        for(int k=0;k<9;k++) if(cover&(1u<<k)) any|=grader_elim(g,t? k*9+o : o*9+k,dm);
+      }
+      if(n<3) break;
+    }
+  }
+  return any;
+}
+static bool tech_naked_pair(Grader*g){ return naked_subset(g,2); }
+static bool tech_hidden_pair(Grader*g){ return hidden_subset(g,2); }
+static bool tech_naked_triple(Grader*g){ return naked_subset(g,3); }
+static bool tech_hidden_triple(Grader*g){ return hidden_subset(g,3); }
+static bool tech_xwing(Grader*g){ return fish(g,2); }
+static bool tech_swordfish(Grader*g){ return fish(g,3); }
+
+static const struct { bool (*apply)(Grader*); Difficulty level; } TECHNIQUES[]={
+  {tech_naked_single,DIFF_EASY}, {tech_hidden_single,DIFF_EASY},
+  {tech_locked,DIFF_MEDIUM}, {tech_naked_pair,DIFF_MEDIUM}, {tech_hidden_pair,DIFF_MEDIUM},
+  {tech_naked_triple,DIFF_HARD}, {tech_hidden_triple,DIFF_HARD}, {tech_xwing,DIFF_HARD},
+  {tech_swordfish,DIFF_EXPERT}
+};
+
+/* hardest technique needed; DIFF_EXTREME if the techniques above get stuck (or puz is broken) */
+static Difficulty grade_puzzle(const uint8_t*puz){
+  Grader g; if(!grader_init(&g,puz)) return DIFF_EXTREME;
+  Difficulty worst=DIFF_EASY;
+  while(g.left>0){
+    size_t t=0;
+    while(t<sizeof(TECHNIQUES)/sizeof(TECHNIQUES[0]) && !TECHNIQUES[t].apply(&g)) { if(g.broken) return DIFF_EXTREME; t++; }
+    if(g.broken || t==sizeof(TECHNIQUES)/sizeof(TECHNIQUES[0])) return DIFF_EXTREME;
+    if(TECHNIQUES[t].level>worst) worst=TECHNIQUES[t].level;
+  }
+  return worst;
+}
+static bool parse_band(const char*s,DiffBand*out){
+  int lo=-1, hi=-1;
+  for(int d=0;d<5;d++){
+    size_t n=strlen(DIFF_NAMES[d]);
+    if(!strncmp(s,DIFF_NAMES[d],n) && (s[n]==0 || s[n]=='-')){ lo=d; s+=n; break; }
+  }
+  if(lo<0) return false;
+  if(*s=='-'){ s++; for(int d=0;d<5;d++) if(!strcmp(s,DIFF_NAMES[d])) hi=d; if(hi<lo) return false; }
+  else hi=lo;
+  out->lo=(Difficulty)lo; out->hi=(Difficulty)hi; return true;
+}
+
+/* solved grid via pattern + shuffles */
+static void make_solved(Rng*rng,uint8_t*out){
+  int rows[9]={0,1,2,3,4,5,6,7,8}, cols[9]={0,1,2,3,4,5,6,7,8}, nums[9]={1,2,3,4,5,6,7,8,9};
+  int band[3]={0,1,2}; shuffle(rng,band,3);
+  int rin[3][3]={{0,1,2},{3,4,5},{6,7,8}}; for(int b=0;b<3;b++) shuffle(rng,rin[b],3);
+  int p=0; for(int b0=0;b0<3;b0++){ int bi=band[b0]; for(int i=0;i<3;i++) rows[p++]=rin[bi][i]; }
+  int stack_[3]={0,1,2}; shuffle(rng,stack_,3);
+  int cin[3][3]={{0,1,2},{3,4,5},{6,7,8}}; for(int s=0;s<3;s++) shuffle(rng,cin[s],3);
+  p=0; for(int s0=0;s0<3;s0++){ int si=stack_[s0]; for(int i=0;i<3;i++) cols[p++]=cin[si][i]; }
+  shuffle(rng,nums,9);
+  for(int r=0;r<9;r++) for(int c=0;c<9;c++){
+    int r2=rows[r], c2=cols[c];
+    int base=(r2*3 + r2/3 + c2) % 9;
+    out[IDX(r,c)]=(uint8_t)nums[base];
+  }
+}
+
+/* The grid was unique with solution sol before cells[0..n) were emptied, so any other
+   solution must differ from sol in one of them. Probe cell k with every candidate but
+   sol[k] (cells before it pinned to sol): each probe is a small search with limit 1. */
+static bool has_alternative(const Core*core,Board*b,const int*cells,int n,const uint8_t*sol){
+  bool alt=false; int k=0;
+  for(;k<n && !alt;k++){
+    int i=cells[k]; unsigned m=board_cand(b,i) & ~(1u<<sol[i]);
+    while(m && !alt){
+      int v=lowbit16(m); m&=m-1;
+      board_set(b,i,v); alt=solver_count(core,b,1,NULL)>0; board_unset(b,i);
+    }
+    board_set(b,i,sol[i]);
+  }
+  for(int q=0;q<k;q++) board_unset(b,cells[q]);
+  return alt;
+}
+
+/* dig symmetric clue pairs in shuffled order while the puzzle stays unique; grid must be solved
+   on entry and ends minimal for that order. Uniqueness is kept by probing only for alternatives
+   at the removed cells (bitboard kept in sync with grid). */
+static void dig_puzzle(const Core*core,Rng*rng,uint8_t*grid){
+  uint8_t sol[81]; memcpy(sol,grid,sizeof(sol));
+  int pos[81]; for(int i=0;i<81;i++) pos[i]=i; shuffle(rng,pos,81);
+  Board cur; board_load(&cur,grid);
+  for(int k=0;k<81;k++){
+    int i=pos[k]; int r=i/9,c=i%9; int j=IDX(8-r,8-c);
+    if(cur.cell[i]==0) continue; /* i and j are always removed together */
+    int cells[2]={i,j}, delta=(j==i)?1:2;
+    board_unset(&cur,i); if(j!=i) board_unset(&cur,j);
+    if(has_alternative(core,&cur,cells,delta,sol)){ board_set(&cur,i,sol[i]); if(j!=i) board_set(&cur,j,sol[j]); }
+  }
+  memcpy(grid,cur.cell,81);
+}
+
+/* Minimal puzzles: after the symmetric dig, try every remaining clue on its own. The probes
+   all start from the same board, so they run speculatively in parallel; the survivors are then
+   committed in shuffled order, each re-checked on the board left by the ones before it. A clue
+   that is needed once stays needed as more clues go (fewer clues only add solutions), so a
+   single pass leaves a puzzle with no removable clue. */
+typedef struct { const Core* core; const Board* cur; const uint8_t* sol; const int* cell; bool* free_; } MinimalJob;
+static void minimal_probe(void*arg,int k){
+  MinimalJob* m=(MinimalJob*)arg; Board b=*m->cur; int i=m->cell[k];
+  board_unset(&b,i); m->free_[k]=!has_alternative(m->core,&b,&i,1,m->sol);
+}
+static void minimize_puzzle(const Core*core,Rng*rng,uint8_t*grid,const uint8_t*sol){
+  int cell[81], n=0; bool free_[81];
+  for(int i=0;i<81;i++) if(grid[i]) cell[n++]=i;
+  shuffle(rng,cell,n);
+  Board cur; board_load(&cur,grid);
+  MinimalJob job={core,&cur,sol,cell,free_};
+  if(core->parallel_for) core->parallel_for(core->pool,n,minimal_probe,&job);
+  else for(int k=0;k<n;k++) minimal_probe(&job,k);
+  bool first=true;
+  for(int k=0;k<n;k++){
+    if(!free_[k]) continue;
+    int i=cell[k];
+    board_unset(&cur,i);
+    if(first || !has_alternative(core,&cur,&i,1,sol)) first=false;   /* the first survivor needs no re-check */
+    else board_set(&cur,i,sol[i]);
+  }
+  memcpy(grid,cur.cell,81);
+}
+
+/* a dug puzzle harder than band.hi is walked back down: put pairs back from sol, taking one
+   that lands in band if any, else one that stays above it. False if every step undershoots. */
+static bool settle_into_band(Rng*rng,uint8_t*grid,const uint8_t*sol,DiffBand band,Difficulty*level){
+  for(;;){
+    int pairs[41], n=0;
+    for(int i=0;i<=40;i++) if(!grid[i]) pairs[n++]=i;
+    if(!n) return false;
+    shuffle(rng,pairs,n);
+    int above=-1;
+    for(int k=0;k<n;k++){
+      int i=pairs[k], j=80-i;
+      grid[i]=sol[i]; grid[j]=sol[j];
+      Difficulty d=grade_puzzle(grid);
+      if(d>=band.lo && d<=band.hi){ *level=d; return true; }
+      if(d>band.hi && above<0) above=i;
+      grid[i]=0; grid[j]=0;
+    }
+    if(above<0) return false;
+    grid[above]=sol[above]; grid[80-above]=sol[80-above];
+  }
+}
+
+/* one puzzle + its solution from an explicit RNG (thread-safe: no shared state).
+   Rejection-samples solved grids until the puzzle lands in band. Expert puzzles take a few
+   hundred grids, so the cap is high; past it the hardest one found that is still <= band.hi is
+   kept. Minimal puzzles cannot be walked back into band (that adds clues) and cost far more per
+   grid, so with core->minimal the cap is lower and the first one is kept if none fits.
+   Returns the puzzle's grade; callers compare it with band to spot a miss. */
+#define GEN_ATTEMPTS 4096
+#define GEN_ATTEMPTS_MINIMAL 256
+static Difficulty generate_puzzle(const Core*core,Rng*rng,DiffBand band,uint8_t*puzzle,uint8_t*solution){
+  uint8_t best[81], bestSol[81]; Difficulty bestD=DIFF_EASY; bool have=false;
+  int attempts = core->minimal? GEN_ATTEMPTS_MINIMAL : GEN_ATTEMPTS;
+  for(int a=0;a<attempts;a++){
+    uint8_t solved[81], dug[81]; make_solved(rng,solved);
+    memcpy(dug,solved,sizeof(solved));
+    dig_puzzle(core,rng,dug);
+    if(core->minimal) minimize_puzzle(core,rng,dug,solved);
+    Difficulty d=grade_puzzle(dug);
+    bool in = d>=band.lo && d<=band.hi;
+    if(d>band.hi && !core->minimal) in=settle_into_band(rng,dug,solved,band,&d);
+    if((d<=band.hi && (!have || bestD>band.hi || d>bestD)) || (core->minimal && !have)){ memcpy(best,dug,sizeof(dug)); memcpy(bestSol,solved,sizeof(solved)); bestD=d; have=true; }
+    if(in) break;
+  }
+  /* every grid overshot band.hi and could not be walked back: fall through to the fixed puzzle */
+  if(have) memcpy(puzzle,best,sizeof(best));
+  if(!have || !unique_solution(core,puzzle,solution) || memcmp(solution,bestSol,sizeof(bestSol))){
+    static const uint8_t safe[81]={
+      5,3,0, 0,7,0, 0,0,0,
+      6,0,0, 1,9,5, 0,0,0,
+      0,9,8, 0,0,0, 0,6,0,
+      8,0,0, 0,6,0, 0,0,3,
+      4,0,0, 8,0,3, 0,0,1,
+      7,0,0, 0,2,0, 0,0,6,
+      0,6,0, 0,0,0, 2,8,0,
+      0,0,0, 4,1,9, 0,0,5,
+      0,0,0, 0,8,0, 0,7,9
+    };
+    memcpy(puzzle,safe,sizeof(safe)); unique_solution(core,puzzle,solution); bestD=grade_puzzle(puzzle);
+  }
+  return bestD;
+}
+
+
+/* ---- Canonical form: the lexicographically smallest image of a puzzle under the Sudoku group
+   (transpose, band/stack order, rows within bands, columns within stacks, digit relabeling),
+   blanks read as 0 and digits relabeled 1,2,.. by first appearance. Branch and bound one output
+   row at a time: a (transpose, column order, row order) candidate survives only while its rows
+   equal the best prefix, so few of the 3.3M layouts are ever extended past the first row. ---- */
+static const unsigned char PERM3[6][3]={{0,1,2},{0,2,1},{1,0,2},{1,2,0},{2,0,1},{2,1,0}};
+typedef struct { unsigned char cols[9], map[10], next, t, last; uint16_t used; } CanonState;
+typedef struct { CanonState* v; size_t n, cap; } CanonList;
+
+static bool canon_push(CanonList*l,const CanonState*s){
+  if(l->n==l->cap){
+    size_t nc=l->cap? l->cap*2 : 1024;
+    CanonState* nv=(CanonState*)realloc(l->v,nc*sizeof(*nv)); if(!nv) return false;
+    l->v=nv; l->cap=nc;
+  }
+  l->v[l->n++]=*s; return true;
+}
+/* source row r read through s->cols, relabeling into s->map; <0, 0, >0 against best */
+static int canon_row(const uint8_t*g,CanonState*s,int r,const unsigned char*best,unsigned char*out){
+  int cmp=0;
+  for(int j=0;j<9;j++){
+    int v=g[r*9+s->cols[j]];
+    if(v && !s->map[v]) s->map[v]=++s->next;
+    out[j]=v? s->map[v] : 0;
+    if(!cmp) cmp=(int)out[j]-(int)best[j];
+  }
+  return cmp;
+}
+/* keeps s if its row r ties the best row so far, restarts the list if it beats it */
+static bool canon_offer(CanonList*l,const uint8_t*g,CanonState s,int r,unsigned char*best){
+  unsigned char row[9]; int cmp=canon_row(g,&s,r,best,row);
+  if(cmp>0) return true;
+  if(cmp<0){ memcpy(best,row,9); l->n=0; }
+  s.used|=(uint16_t)(1u<<r); s.last=(unsigned char)r;
+  return canon_push(l,&s);
+}
+
+static uint64_t grid_hash(const uint8_t*g){
+  uint64_t h=0x5344534B50554Bull, w=0;   /* nibbles, 16 per word */
+  for(int i=0;i<81;i++){ w=w<<4 | (uint64_t)(g[i]&15); if((i&15)==15 || i==80){ h=mix64(h^w); w=0; } }
+  return h;
+}
+
+/* canonical form into out (may be NULL); returns its 64-bit hash, equal for equivalent puzzles.
+   0 if out of memory (out untouched). */
+static uint64_t canonical_form(const uint8_t*puz,uint8_t*out){
+  uint8_t g[2][81];
+  for(int i=0;i<81;i++){ g[0][i]=puz[i]; g[1][IDX(i%9,i/9)]=puz[i]; }
+  CanonList cur={0}, nxt={0}; bool ok=true;
+  unsigned char best[9]; memset(best,10,9);
+  /* first output row. A blank sorts before any digit, so it must have the smallest clue pattern:
+     stacks by ascending clue count, clues at the right of each stack. Only source rows that can
+     reach it are tried, and only with column orders that produce it. */
+  int pat[2][9], minpat=1<<9;
+  for(int t=0;t<2;t++) for(int r=0;r<9;r++){
+    int n[3]={0,0,0}; for(int c=0;c<9;c++) n[c/3]+=g[t][r*9+c]!=0;
+    for(int i=1;i<3;i++) for(int j=i;j>0 && n[j-1]>n[j];j--){ int x=n[j]; n[j]=n[j-1]; n[j-1]=x; }
+    pat[t][r]=((1<<n[0])-1)<<6 | ((1<<n[1])-1)<<3 | ((1<<n[2])-1);
+    if(pat[t][r]<minpat) minpat=pat[t][r];
+  }
+  for(int t=0;t<2 && ok;t++) for(int r=0;r<9 && ok;r++){
+    if(pat[t][r]!=minpat) continue;
+    const uint8_t* row=g[t]+r*9;
+    for(int st=0;st<6 && ok;st++){
+      int p3[3][6];   /* clue bits of each stack under each in-stack order; prune stack by stack */
+      for(int k=0;k<3;k++) for(int a=0;a<6;a++){ const unsigned char* q=PERM3[a]; int base=PERM3[st][k]*3; p3[k][a]=(row[base+q[0]]!=0)<<2 | (row[base+q[1]]!=0)<<1 | (row[base+q[2]]!=0); }
+      for(int a=0;a<6 && ok;a++){ if(p3[0][a]!=(minpat>>6)) continue;
+      for(int b=0;b<6 && ok;b++){ if(p3[1][b]!=(minpat>>3&7)) continue;
+      for(int c=0;c<6 && ok;c++){ if(p3[2][c]!=(minpat&7)) continue;
+        CanonState s; memset(&s,0,sizeof(s)); s.t=(unsigned char)t;
+        const unsigned char* in[3]={PERM3[a],PERM3[b],PERM3[c]};
+        for(int k=0;k<3;k++) for(int j=0;j<3;j++) s.cols[k*3+j]=(unsigned char)(PERM3[st][k]*3+in[k][j]);
+        ok=canon_offer(&cur,g[t],s,r,best);
+      }}}
+    }
+  }
+  uint8_t res[81]; for(int j=0;j<9;j++) res[j]=best[j];
+  /* each further row: the next row of the current band, or the first row of an unused band */
+  for(int k=1;k<9 && ok;k++){
+    memset(best,10,9); nxt.n=0;
+    for(size_t q=0;q<cur.n && ok;q++){
+      const CanonState* s=&cur.v[q];
+      for(int r=0;r<9 && ok;r++){
+        if(s->used>>r&1) continue;
+        if(k%3 ? r/3!=s->last/3 : (s->used>>(r/3*3)&7)!=0) continue;
+        ok=canon_offer(&nxt,g[s->t],*s,r,best);
+      }
+    }
+    for(int j=0;j<9;j++) res[k*9+j]=best[j];
+    CanonList tmp=cur; cur=nxt; nxt=tmp;
+  }
+  free(cur.v); free(nxt.v);
+  if(!ok) return 0;
+  if(out) memcpy(out,res,sizeof(res));
+  return grid_hash(res);
+}
+
+/* ---- Set of 64-bit hashes: open addressing, linear probing, grows at 1/2 load (0 = empty slot).
+   8 bytes per entry; two distinct puzzles collide with probability ~n^2/2^65. ---- */
+typedef struct { uint64_t* slot; size_t cap, count; } HashSet;
+
+static void hashset_free(HashSet*s){ free(s->slot); memset(s,0,sizeof(*s)); }
+static bool hashset_grow(HashSet*s){
+  size_t nc=s->cap? s->cap*2 : 1024;
+  uint64_t* ns=(uint64_t*)calloc(nc,sizeof(uint64_t)); if(!ns) return false;
+  for(size_t i=0;i<s->cap;i++){
+    uint64_t h=s->slot[i]; if(!h) continue;
+    size_t j=(size_t)h&(nc-1); while(ns[j]) j=(j+1)&(nc-1); ns[j]=h;
+  }
+  free(s->slot); s->slot=ns; s->cap=nc; return true;
+}
+/* 1 if h was added, 0 if already present, -1 if out of memory */
+static int hashset_add(HashSet*s,uint64_t h){
+  if(!h) h=1;
+  if(2*(s->count+1)>s->cap && !hashset_grow(s)) return -1;
+  size_t j=(size_t)h&(s->cap-1);
+  while(s->slot[j]){ if(s->slot[j]==h) return 0; j=(j+1)&(s->cap-1); }
+  s->slot[j]=h; s->count++; return 1;
+}
+
+/* ---- Other board sizes: one compile-time specialized engine per box size ---- */
+#define SZ_BOX 2
+#define SZ_MASK uint16_t
+#define SZ(name) name##_4
+#include "sudokura_sized.h"
+#define SZ_BOX 4
+#define SZ_MASK uint32_t
+#define SZ(name) name##_16
+#include "sudokura_sized.h"
+#define SZ_BOX 5
+#define SZ_MASK uint32_t
+#define SZ(name) name##_25
+#include "sudokura_sized.h"
+
+static bool valid_box(int box){ return box>=2 && box<=MAX_BOX; }
+
+static bool is_solved(const Game*g){
+  for(int i=0;i<g->side*g->side;i++){ if(g->puzzle[i]==0) return false; if(g->puzzle[i]!=g->solution[i]) return false; } return true;
+}
+/* ---- Conflict tracking: every write to g->puzzle goes through game_set ---- */
+static inline int game_box_of(const Game*g,int r,int c){ return (r/g->box)*g->box + c/g->box; }
+static inline bool cell_in_conflict(const Game*g,int i){ return (g->conflict[i>>6]>>(i&63))&1; }
+static void conflict_refresh(Game*g,int i){
+  int v=g->puzzle[i], r=i/g->side, c=i%g->side;
+  bool now = v && (g->unit_cnt[0][r][v]>1 || g->unit_cnt[1][c][v]>1 || g->unit_cnt[2][game_box_of(g,r,c)][v]>1);
+  if(now!=cell_in_conflict(g,i)){ g->conflict[i>>6]^=1ull<<(i&63); g->conflicts+= now? 1 : -1; }
+}
+static void unit_count(Game*g,int r,int c,int v,int d){
+  if(!v) return;
+  int u[3]={r,c,game_box_of(g,r,c)};
+  for(int k=0;k<3;k++){
+    uint8_t* cnt=&g->unit_cnt[k][u[k]][v]; *cnt+=d;
+    if(*cnt) g->unit_mask[k][u[k]]|=1u<<v; else g->unit_mask[k][u[k]]&=~(1u<<v);
+  }
+}
+static void game_set(Game*g,int i,int v){
+  int n=g->side, b=g->box, r=i/n, c=i%n, old=g->puzzle[i];
+  if(old==v) return;
+  unit_count(g,r,c,old,-1); unit_count(g,r,c,v,+1); g->puzzle[i]=(uint8_t)v;
+  /* only cells of the three units holding the old or the new digit can change state */
+  int br=(r/b)*b, bc=(c/b)*b;
+  for(int k=0;k<n;k++){
+    int j[3]={ r*n+k, k*n+c, (br+k/b)*n + bc+k%b };
+    for(int u=0;u<3;u++){ int w=g->puzzle[j[u]]; if(w && (w==old || w==v)) conflict_refresh(g,j[u]); }
+  }
+  conflict_refresh(g,i);
+}
+static void game_rebuild(Game*g){
+  memset(g->unit_cnt,0,sizeof g->unit_cnt); memset(g->unit_mask,0,sizeof g->unit_mask);
+  memset(g->conflict,0,sizeof g->conflict); g->conflicts=0;
+  int n=g->side;
+  for(int i=0;i<n*n;i++) unit_count(g,i/n,i%n,g->puzzle[i],+1);
+  for(int i=0;i<n*n;i++) conflict_refresh(g,i);
+}
+/* would v at (r,c) repeat a digit already in its row, column or box? O(1) from the counters */
+static bool has_conflict(const Game*g,int r,int c,int v){
+  if(v==0) return false;
+  int self = g->puzzle[GIDX(g,r,c)]==v;
+  return g->unit_cnt[0][r][v]>self || g->unit_cnt[1][c][v]>self || g->unit_cnt[2][game_box_of(g,r,c)][v]>self;
+}
+static bool place(Game*g,int r,int c,int v,bool strict){
+  int i=GIDX(g,r,c);
+  if(game_fixed(g,i)) return false;
+  if(v==0){ game_set(g,i,0); g->notes[i]=0; return true; }
+  if(strict && has_conflict(g,r,c,v)) return false;
+  game_set(g,i,v); g->notes[i]=0; return true;
+}
+static bool give_hint(Game*g,int r,int c){
+  int i=GIDX(g,r,c);
+  if(game_fixed(g,i)) return false;
+  int corr=g->solution[i];
+  if(g->puzzle[i]==corr) return false;
+  game_set(g,i,corr); g->notes[i]=0; return true;
+}
+static int count_conflicts(const Game*g){ return g->conflicts; }
+
+/* ---- Pencil marks from the unit masks: legal digits of a cell in O(1) ---- */
+static inline uint32_t game_candidates(const Game*g,int i){
+  int n=g->side, r=i/n, c=i%n;
+  return (((1u<<n)-1)<<1) & ~(g->unit_mask[0][r] | g->unit_mask[1][c] | g->unit_mask[2][game_box_of(g,r,c)]);
+}
+/* auto-notes: every empty cell gets its candidates */
+static void game_fill_notes(Game*g){
+  for(int i=0;i<g->side*g->side;i++) g->notes[i] = g->puzzle[i]? 0 : game_candidates(g,i);
+}
+/* Cell i went from old to its current digit: drop that digit from the notes of its empty peers
+   and, with refill (auto-notes), give old back to the peers where it is legal again and fresh
+   candidates to i if it was cleared. Only the three units of i are visited. */
+static void game_update_notes(Game*g,int i,int old,bool refill){
+  int n=g->side, b=g->box, r=i/n, c=i%n, v=g->puzzle[i], br=(r/b)*b, bc=(c/b)*b;
+  uint32_t keep = v? ~(1u<<v) : ~0u, back = refill && old? 1u<<old : 0;
+  for(int k=0;k<n;k++){
+    int j[3]={ r*n+k, k*n+c, (br+k/b)*n + bc+k%b };
+    for(int u=0;u<3;u++) if(!g->puzzle[j[u]]){ g->notes[j[u]]&=keep; if(back) g->notes[j[u]]|=back&game_candidates(g,j[u]); }
+  }
+  if(refill && !v) g->notes[i]=game_candidates(g,i);
+}
+
+/* =================== PUZZLE PACKS (memory-mapped) =================== */
+/* File layout, little-endian:
+     header (64 bytes): "SKPK", u16 version, u16 flags (bit0: solutions), u32 count,
+       u32 record size, u32 first[5] + u32 num[5] (records are sorted by Difficulty),
+       u32 payload CRC-32, u32 header CRC-32 (over the 56 bytes before it), 4 bytes pad
+     records: 41 bytes of clues (cell 2k low nibble, 2k+1 high nibble, 0 = blank),
+       then 41 bytes of solution if flags bit0. */
+#define PACK_MAGIC   "SKPK"
+#define PACK_VERSION 1
+#define PACK_HDR     64
+#define PACK_CELLS   41
+#define PACK_HAS_SOL 1u
+
+typedef struct Pack {
+  const unsigned char* base; size_t size;
+  uint32_t count, rec_size, first[5], num[5]; bool has_sol;
+#if defined(_WIN32)
+  HANDLE file, map;
+#else
+  int fd;
+#endif
+} Pack;
+
+
+static uint32_t crc32_update(uint32_t crc,const unsigned char*p,size_t n){
+  static const uint32_t T[16]={
+    0x00000000,0x1DB71064,0x3B6E20C8,0x26D930AC,0x76DC4190,0x6B6B51F4,0x4DB26158,0x5005713C,
+    0xEDB88320,0xF00F9344,0xD6D6A3E8,0xCB61B38C,0x9B64C2B0,0x86D3D2D4,0xA00AE278,0xBDBDF21C };
+  crc=~crc;
+  for(size_t i=0;i<n;i++){ crc=(crc>>4)^T[(crc^p[i])&15]; crc=(crc>>4)^T[(crc^(p[i]>>4))&15]; }
+  return ~crc;
+}
+static inline uint32_t rd32(const unsigned char*p){ return (uint32_t)p[0]|(uint32_t)p[1]<<8|(uint32_t)p[2]<<16|(uint32_t)p[3]<<24; }
+static inline void wr32(unsigned char*p,uint32_t v){ p[0]=(unsigned char)v; p[1]=(unsigned char)(v>>8); p[2]=(unsigned char)(v>>16); p[3]=(unsigned char)(v>>24); }
+static void pack_cells(const uint8_t*g,unsigned char out[PACK_CELLS]){
+  for(int k=0;k<PACK_CELLS;k++) out[k]=(unsigned char)(g[2*k] | (2*k+1<81? g[2*k+1]<<4 : 0));
+}
+static void unpack_cells(const unsigned char in[PACK_CELLS],uint8_t*g){
+  for(int i=0;i<81;i++) g[i]=(uint8_t)((in[i>>1]>>((i&1)*4))&15);
+}
+
+static void pack_close(Pack*p){
+  if(!p) return;
+#if defined(_WIN32)
+  if(p->base) UnmapViewOfFile(p->base);
+  if(p->map) CloseHandle(p->map);
+  if(p->file!=INVALID_HANDLE_VALUE) CloseHandle(p->file);
+#else
+  if(p->base) munmap((void*)p->base,p->size);
+  if(p->fd>=0) close(p->fd);
+#endif
+  free(p);
+}
+/* maps the file and checks the header only; records are paged in when drawn */
+static Pack* pack_open(const char*path,char*err,size_t errn){
+  Pack* p=(Pack*)calloc(1,sizeof(Pack)); if(!p){ snprintf(err,errn,"out of memory"); return NULL; }
+#if defined(_WIN32)
+  p->file=CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+  LARGE_INTEGER sz;
+  if(p->file==INVALID_HANDLE_VALUE || !GetFileSizeEx(p->file,&sz)){ snprintf(err,errn,"cannot open %s",path); pack_close(p); return NULL; }
+  p->size=(size_t)sz.QuadPart;
+  if(p->size>=PACK_HDR){
+    p->map=CreateFileMappingA(p->file,NULL,PAGE_READONLY,0,0,NULL);
+    if(p->map) p->base=(const unsigned char*)MapViewOfFile(p->map,FILE_MAP_READ,0,0,0);
+  }
+#else
+  struct stat st;
+  p->fd=open(path,O_RDONLY);
+  if(p->fd<0 || fstat(p->fd,&st)!=0){ snprintf(err,errn,"cannot open %s",path); pack_close(p); return NULL; }
+  p->size=(size_t)st.st_size;
+  if(p->size>=PACK_HDR){
+    void* m=mmap(NULL,p->size,PROT_READ,MAP_SHARED,p->fd,0);
+    if(m!=MAP_FAILED) p->base=(const unsigned char*)m;
+  }
+#endif
+  if(!p->base){ snprintf(err,errn,"%s: not a puzzle pack (too small or cannot map)",path); pack_close(p); return NULL; }
+  const unsigned char* h=p->base;
+  if(memcmp(h,PACK_MAGIC,4) || (h[4]|h[5]<<8)!=PACK_VERSION){ snprintf(err,errn,"%s: bad magic or version",path); pack_close(p); return NULL; }
+  if(rd32(h+60)!=crc32_update(0,h,60)){ snprintf(err,errn,"%s: header checksum mismatch",path); pack_close(p); return NULL; }
+  p->has_sol=((h[6]|h[7]<<8)&PACK_HAS_SOL)!=0;
+  p->count=rd32(h+8); p->rec_size=rd32(h+12);
+  uint64_t total=0;
+  for(int d=0;d<5;d++){ p->first[d]=rd32(h+16+4*d); p->num[d]=rd32(h+36+4*d); total+=p->num[d];
+    if((uint64_t)p->first[d]+p->num[d]>p->count){ total=~0ull; break; } }
+  if(p->rec_size!=(p->has_sol? 2u*PACK_CELLS : PACK_CELLS) || total!=p->count
+     || (uint64_t)PACK_HDR+(uint64_t)p->count*p->rec_size>p->size){
+    snprintf(err,errn,"%s: inconsistent header",path); pack_close(p); return NULL;
+  }
+  return p;
+}
+/* puzzle k of the pack; false if the record is corrupt (clues must agree with a valid solution) */
+static bool pack_get(const Core*core,const Pack*p,uint32_t k,uint8_t*puzzle,uint8_t*solution){
+  const unsigned char* r=p->base+PACK_HDR+(size_t)k*p->rec_size;
+  unpack_cells(r,puzzle);
+  if(!p->has_sol) return unique_solution(core,puzzle,solution);
+  unpack_cells(r+PACK_CELLS,solution);
+  Board b; if(!board_load(&b,solution)) return false;
+  for(int i=0;i<81;i++) if(!solution[i] || (puzzle[i] && puzzle[i]!=solution[i])) return false;
+  return true;
+}
+/* O(1): uniform over the records whose difficulty is inside band */
+static bool pack_draw(const Core*core,const Pack*p,DiffBand band,Rng*rng,uint8_t*puzzle,uint8_t*solution){
+  uint64_t total=0; for(int d=(int)band.lo;d<=(int)band.hi;d++) total+=p->num[d];
+  if(!total) return false;
+  uint64_t k=rng_next(rng)%total;
+  for(int d=(int)band.lo;d<=(int)band.hi;d++){
+    if(k<p->num[d]) return pack_get(core,p,p->first[d]+(uint32_t)k,puzzle,solution);
+    k-=p->num[d];
+  }
+  return false;
+}
+/* full check: payload CRC plus uniqueness and grade of every record */
+static int run_verify_pack(const Core*core,const char*path){
+  char err[256]; Pack* p=pack_open(path,err,sizeof(err));
+  if(!p){ fprintf(stderr,"%s\n",err); return 1; }
+  int bad=0;
+  if(rd32(p->base+56)!=crc32_update(0,p->base+PACK_HDR,(size_t)p->count*p->rec_size)){ fprintf(stderr,"%s: payload checksum mismatch\n",path); bad++; }
+  for(int d=0;d<5;d++) for(uint32_t k=0;k<p->num[d];k++){
+    uint8_t puz[81], sol[81], chk[81];
+    if(!pack_get(core,p,p->first[d]+k,puz,sol) || !unique_solution(core,puz,chk) || memcmp(chk,sol,sizeof(sol)) || grade_puzzle(puz)!=(Difficulty)d){
+      if(bad<10) fprintf(stderr,"%s: record %u is invalid\n",path,(unsigned)(p->first[d]+k));
+      bad++;
+    }
+  }
+  fprintf(stderr,"%s: %u puzzles (easy %u, medium %u, hard %u, expert %u, extreme %u), %s, %d problem(s)\n",
+          path,(unsigned)p->count,(unsigned)p->num[0],(unsigned)p->num[1],(unsigned)p->num[2],(unsigned)p->num[3],(unsigned)p->num[4],
+          p->has_sol?"with solutions":"clues only",bad);
+  pack_close(p);
+  return bad?1:0;
+}
+
+/* writer: records are bucketed by difficulty in memory, then written sorted */
+typedef struct { unsigned char* buf[5]; size_t len[5], cap[5]; uint32_t num[5]; bool with_sol; } PackWriter;
+
+static bool pack_writer_add(PackWriter*w,const uint8_t*puzzle,const uint8_t*solution,Difficulty d){
+  size_t rs=w->with_sol? 2*PACK_CELLS : PACK_CELLS;
+  if(w->len[d]+rs>w->cap[d]){
+    size_t nc=w->cap[d]? w->cap[d]*2 : 64*rs;
+    unsigned char* nb=(unsigned char*)realloc(w->buf[d],nc);
+    if(!nb) return false;
+    w->buf[d]=nb; w->cap[d]=nc;
+  }
+  pack_cells(puzzle,w->buf[d]+w->len[d]);
+  if(w->with_sol) pack_cells(solution,w->buf[d]+w->len[d]+PACK_CELLS);
+  w->len[d]+=rs; w->num[d]++;
+  return true;
+}
+static bool pack_writer_finish(PackWriter*w,const char*path){
+  unsigned char h[PACK_HDR]={0}; uint32_t first=0, payload=0;
+  memcpy(h,PACK_MAGIC,4); h[4]=PACK_VERSION; h[6]=w->with_sol? PACK_HAS_SOL : 0;
+  wr32(h+12,w->with_sol? 2*PACK_CELLS : PACK_CELLS);
+  for(int d=0;d<5;d++){ wr32(h+16+4*d,first); wr32(h+36+4*d,w->num[d]); first+=w->num[d]; payload=crc32_update(payload,w->buf[d],w->len[d]); }
+  wr32(h+8,first); wr32(h+56,payload); wr32(h+60,crc32_update(0,h,60));
+  FILE* f=fopen(path,"wb"); bool ok=f!=NULL;
+  if(ok) ok=fwrite(h,1,PACK_HDR,f)==PACK_HDR;
+  for(int d=0;d<5 && ok;d++) ok=fwrite(w->buf[d],1,w->len[d],f)==w->len[d];
+  if(f && fclose(f)!=0) ok=false;
+  for(int d=0;d<5;d++) free(w->buf[d]);
+  return ok;
+}
+
+/* box 3: from the pack or the graded 9x9 generator (core->band); other sizes: sized engine */
+static void new_game(const Core*core,int box,Game*g,Rng*rng){
+  uint8_t puzzle[MAX_CELLS], finalSol[MAX_CELLS];
+  if(box==2) generate_4(rng,puzzle,finalSol);
+  else if(box==4) generate_16(rng,puzzle,finalSol);
+  else if(box==5) generate_25(rng,puzzle,finalSol);
+  else{ box=3; if(!core->pack || !pack_draw(core,core->pack,core->band,rng,puzzle,finalSol)) generate_puzzle(core,rng,core->band,puzzle,finalSol); }
+  int cells=box*box*box*box;
+  g->box=box; g->side=box*box;
+  memcpy(g->puzzle,puzzle,(size_t)cells); memcpy(g->solution,finalSol,(size_t)cells);
+  memset(g->fixed,0,sizeof g->fixed); memset(g->notes,0,sizeof g->notes);
+  for(int i=0;i<cells;i++) if(puzzle[i]) g->fixed[i>>6]|=1ull<<(i&63);
+  game_rebuild(g);
+}
+
+static void core_free(Core*c){ free(c->dlx); pack_close(c->pack); c->dlx=NULL; c->pack=NULL; }
+
+#endif /* SUDOKURA_CORE_H */
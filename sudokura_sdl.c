@@ -13,13 +13,19 @@
       gcc -std=c11 -O2 -Wall -Wextra \
         sudokura_sdl.c -o sudokura \
         $(pkg-config --cflags --libs sdl2 SDL2_ttf) \
-        -lm
+        -lm -pthread
+    Headless: ./sudokura --generate N [--threads T] [--seed S] [--dedup] [--minimal] > puzzles.txt
+              ./sudokura --solve [FILE] [--threads T] < puzzles.txt > solutions.txt
+              ./sudokura --count [FILE] [--limit L] [--threads T] < puzzles.txt > counts.txt
 */
 
 #if !defined(_WIN32)
   #ifndef _POSIX_C_SOURCE
   #define _POSIX_C_SOURCE 200809L
   #endif
+  #ifndef _DEFAULT_SOURCE
+  #define _DEFAULT_SOURCE   /* d_type / DT_DIR for the font scan */
+  #endif
 #endif
 
 #include <stdio.h>
@@ -37,6 +43,8 @@
 #if defined(_WIN32)
   #include <windows.h>
   #include <io.h>
+  #include <sys/types.h>
+  #include <sys/stat.h>
   #ifndef PATH_MAX
   #define PATH_MAX MAX_PATH
   #endif
@@ -50,143 +58,611 @@
   #include <sys/stat.h>
   #include <unistd.h>
 #endif
+#if !defined(_WIN32)
+  #include <pthread.h>
+#endif
+
+#include "sudokura_core.h"
+
+/* =================== THREADS (native, no SDL needed) =================== */
+#if defined(_WIN32)
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef struct { int (*fn)(void*); void* arg; } ThreadStart;
+static DWORD WINAPI thread_tramp(LPVOID p){ ThreadStart ts=*(ThreadStart*)p; free(p); return (DWORD)ts.fn(ts.arg); }
+static bool thread_start(Thread*t,int (*fn)(void*),void*arg){
+  ThreadStart* ts=(ThreadStart*)malloc(sizeof(*ts)); if(!ts) return false; ts->fn=fn; ts->arg=arg;
+  *t=CreateThread(NULL,0,thread_tramp,ts,0,NULL); if(!*t){ free(ts); return false; } return true;
+}
+static void thread_join(Thread t){ WaitForSingleObject(t,INFINITE); CloseHandle(t); }
+static void mutex_init(Mutex*m){ InitializeCriticalSection(m); }
+static void mutex_destroy(Mutex*m){ DeleteCriticalSection(m); }
+static void mutex_lock(Mutex*m){ EnterCriticalSection(m); }
+static void mutex_unlock(Mutex*m){ LeaveCriticalSection(m); }
+static void cond_init(Cond*c){ InitializeConditionVariable(c); }
+static void cond_destroy(Cond*c){ (void)c; }
+static void cond_wait(Cond*c,Mutex*m){ SleepConditionVariableCS(c,m,INFINITE); }
+static void cond_signal(Cond*c){ WakeConditionVariable(c); }
+static void cond_broadcast(Cond*c){ WakeAllConditionVariable(c); }
+static int cpu_count(void){ SYSTEM_INFO si; GetSystemInfo(&si); return (int)si.dwNumberOfProcessors; }
+static long atom_add(volatile long*v,long d){ return InterlockedExchangeAdd(v,d)+d; }   /* new value */
+static long atom_get(volatile long*v){ return InterlockedCompareExchange(v,0,0); }
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef struct { int (*fn)(void*); void* arg; } ThreadStart;
+static void* thread_tramp(void*p){ ThreadStart ts=*(ThreadStart*)p; free(p); ts.fn(ts.arg); return NULL; }
+static bool thread_start(Thread*t,int (*fn)(void*),void*arg){
+  ThreadStart* ts=(ThreadStart*)malloc(sizeof(*ts)); if(!ts) return false; ts->fn=fn; ts->arg=arg;
+  if(pthread_create(t,NULL,thread_tramp,ts)!=0){ free(ts); return false; } return true;
+}
+static void thread_join(Thread t){ pthread_join(t,NULL); }
+static void mutex_init(Mutex*m){ pthread_mutex_init(m,NULL); }
+static void mutex_destroy(Mutex*m){ pthread_mutex_destroy(m); }
+static void mutex_lock(Mutex*m){ pthread_mutex_lock(m); }
+static void mutex_unlock(Mutex*m){ pthread_mutex_unlock(m); }
+static void cond_init(Cond*c){ pthread_cond_init(c,NULL); }
+static void cond_destroy(Cond*c){ pthread_cond_destroy(c); }
+static void cond_wait(Cond*c,Mutex*m){ pthread_cond_wait(c,m); }
+static void cond_signal(Cond*c){ pthread_cond_signal(c); }
+static void cond_broadcast(Cond*c){ pthread_cond_broadcast(c); }
+static int cpu_count(void){ long n=sysconf(_SC_NPROCESSORS_ONLN); return n>0? (int)n : 1; }
+static long atom_add(volatile long*v,long d){ return __atomic_add_fetch(v,d,__ATOMIC_SEQ_CST); }   /* new value */
+static long atom_get(volatile long*v){ return __atomic_load_n(v,__ATOMIC_SEQ_CST); }
+#endif
+
+/* ---- Work pool behind Core.parallel_for: fixed threads, one job at a time. A caller that
+   finds the pool busy runs its loop inline, so batch workers sharing a Core never wait on each
+   other; the caller also works on its own job. Indices are claimed one by one. ---- */
+typedef struct {
+  Mutex mu; Cond work, done;
+  Thread* th; int nth;
+  bool busy, quit;
+  void (*fn)(void*,int); void* arg; int n, next, pending;
+} Pool;
+
+static int pool_worker(void*arg){
+  Pool*p=(Pool*)arg;
+  mutex_lock(&p->mu);
+  for(;;){
+    while(!p->quit && p->next>=p->n) cond_wait(&p->work,&p->mu);
+    if(p->quit) break;
+    int k=p->next++; void (*fn)(void*,int)=p->fn; void* a=p->arg;
+    mutex_unlock(&p->mu);
+    fn(a,k);
+    mutex_lock(&p->mu);
+    if(--p->pending==0) cond_signal(&p->done);
+  }
+  mutex_unlock(&p->mu);
+  return 0;
+}
+static void pool_for(void*pool,int n,void (*fn)(void*,int),void*arg){
+  Pool*p=(Pool*)pool;
+  mutex_lock(&p->mu);
+  if(p->busy || !p->nth || n<2){ mutex_unlock(&p->mu); for(int k=0;k<n;k++) fn(arg,k); return; }
+  p->busy=true; p->fn=fn; p->arg=arg; p->n=n; p->next=0; p->pending=n;
+  cond_broadcast(&p->work);
+  while(p->next<p->n){ int k=p->next++; mutex_unlock(&p->mu); fn(arg,k); mutex_lock(&p->mu); p->pending--; }
+  while(p->pending>0) cond_wait(&p->done,&p->mu);
+  p->busy=false; p->n=p->next=0;
+  mutex_unlock(&p->mu);
+}
+static void pool_start(Pool*p,int threads){
+  memset(p,0,sizeof(*p));
+  mutex_init(&p->mu); cond_init(&p->work); cond_init(&p->done);
+  p->th=(Thread*)malloc(sizeof(Thread)*(size_t)(threads>0? threads : 1));
+  for(int t=0;p->th && t<threads;t++) if(thread_start(&p->th[p->nth],pool_worker,p)) p->nth++;
+}
+static void pool_stop(Pool*p){
+  mutex_lock(&p->mu); p->quit=true; cond_broadcast(&p->work); mutex_unlock(&p->mu);
+  for(int t=0;t<p->nth;t++) thread_join(p->th[t]);
+  free(p->th); mutex_destroy(&p->mu); cond_destroy(&p->work); cond_destroy(&p->done);
+}
+
+/* =================== HEADLESS BATCH GENERATION =================== */
+/* Puzzle k always uses rng_make(seed,k), so output is identical for any thread count.
+   Workers fill a bounded window of slots; the main thread writes them in index order.
+   With dedup, workers also hash each puzzle's canonical form and the writer drops repeats. */
+typedef struct { uint8_t puzzle[81], solution[81]; Difficulty level; uint64_t canon; } BatchItem;
+typedef struct {
+  Mutex mu; Cond can_write, can_work;
+  long total, next, written;   /* next index to claim / next index to print */
+  int window;
+  BatchItem* slot; unsigned char* ready;
+  uint64_t seed; bool dedup;
+  const Core* core;
+} BatchGen;
+
+static void puzzle_to_line(const uint8_t*p,char line[82]){ for(int i=0;i<81;i++) line[i]=p[i]? (char)('0'+p[i]) : '.'; line[81]=0; }
+
+static int batch_worker(void*arg){
+  BatchGen*b=(BatchGen*)arg;
+  for(;;){
+    mutex_lock(&b->mu);
+    while(b->next<b->total && b->next-b->written>=b->window) cond_wait(&b->can_work,&b->mu);
+    if(b->next>=b->total){ mutex_unlock(&b->mu); return 0; }
+    long k=b->next++;
+    mutex_unlock(&b->mu);
+
+    Rng rng=rng_make(b->seed,(uint64_t)k);
+    BatchItem it; it.level=generate_puzzle(b->core,&rng,b->core->band,it.puzzle,it.solution);
+    it.canon = b->dedup? canonical_form(it.puzzle,NULL) : 0;
+
+    mutex_lock(&b->mu);
+    int s=(int)(k % b->window);
+    b->slot[s]=it; b->ready[s]=1;
+    if(k==b->written) cond_signal(&b->can_write);
+    mutex_unlock(&b->mu);
+  }
+}
+
+/* text lines to out, or a puzzle pack at pack_out (with solutions). With dedup, count distinct
+   puzzles (up to isomorphism) are written and generation runs past index count as needed. */
+static int run_generate(const Core*core,long count,int threads,uint64_t seed,bool dedup,FILE*out,const char*pack_out){
+  if(threads<1) threads=cpu_count();
+  BatchGen b; memset(&b,0,sizeof(b));
+  b.total=dedup? LONG_MAX : count; b.seed=seed; b.window=threads*64; b.core=core; b.dedup=dedup;
+  b.slot=malloc(sizeof(*b.slot)*(size_t)b.window); b.ready=calloc((size_t)b.window,1);
+  Thread* th=malloc(sizeof(Thread)*(size_t)threads);
+  mutex_init(&b.mu); cond_init(&b.can_write); cond_init(&b.can_work);
+  PackWriter pw; memset(&pw,0,sizeof(pw)); pw.with_sol=true;
+  HashSet seen; memset(&seen,0,sizeof(seen));
+  long kept=0, dups=0, missed=0; bool ok=b.slot && b.ready && th;
+  if(!ok) fprintf(stderr,"out of memory\n");
+
+  struct timespec t0; timespec_get(&t0,TIME_UTC);
+  int started=0;
+  for(int t=0;ok && t<threads;t++) if(thread_start(&th[started],batch_worker,&b)) started++;
+  if(ok && !started){ fprintf(stderr,"could not start worker threads\n"); ok=false; }
+
+  if(started){
+    mutex_lock(&b.mu);
+    while(kept<count && ok){
+      int s=(int)(b.written % b.window);
+      while(!b.ready[s]) cond_wait(&b.can_write,&b.mu);
+      BatchItem it=b.slot[s]; b.ready[s]=0; b.written++;
+      cond_broadcast(&b.can_work);
+      mutex_unlock(&b.mu);
+      int fresh = dedup? hashset_add(&seen,it.canon) : 1;
+      if(fresh<0){ fprintf(stderr,"out of memory\n"); ok=false; }
+      else if(!fresh) dups++;
+      else{
+        kept++; missed += it.level<core->band.lo || it.level>core->band.hi;
+        if(pack_out) ok = pack_writer_add(&pw,it.puzzle,it.solution,it.level) && ok;
+        else{ char line[82]; puzzle_to_line(it.puzzle,line); fputs(line,out); fputc('\n',out); }
+      }
+      mutex_lock(&b.mu);
+    }
+    b.total=b.next;   /* stop claiming; in-flight puzzles are discarded */
+    cond_broadcast(&b.can_work);
+    mutex_unlock(&b.mu);
+    for(int t=0;t<started;t++) thread_join(th[t]);
+    if(pack_out) ok = pack_writer_finish(&pw,pack_out) && ok;
+    else fflush(out);
+    if(!ok) fprintf(stderr,"could not write %s\n", pack_out? pack_out : "output");
+
+    struct timespec t1; timespec_get(&t1,TIME_UTC);
+    double dt=(double)(t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)*1e-9;
+    fprintf(stderr,"Generated %ld puzzles in %.2f s (%.0f/s, %d threads, seed %llu)",
+            kept, dt, dt>0? kept/dt : 0.0, started, (unsigned long long)seed);
+    if(dedup) fprintf(stderr,", dropped %ld isomorphic duplicates",dups);
+    fputc('\n',stderr);
+    if(missed) fprintf(stderr,"warning: %ld puzzles missed the requested difficulty band\n",missed);
+  }
+  hashset_free(&seen);
+  mutex_destroy(&b.mu); cond_destroy(&b.can_write); cond_destroy(&b.can_work);
+  free(th); free(b.slot); free(b.ready);
+  return ok?0:1;
+}
+
+/* =================== HEADLESS SOLVE STREAM =================== */
+/* Reader thread -> solver workers -> main thread writer over a ring of `window` slots:
+   memory stays bounded for any input size and answers come out in input order. */
+typedef enum { VERDICT_UNIQUE=0, VERDICT_UNSOLVABLE, VERDICT_MULTIPLE, VERDICT_INVALID } Verdict;
+static const char* VERDICT_NAMES[4]={"unique","UNSOLVABLE","MULTIPLE","INVALID"};
+typedef enum { SLOT_FREE=0, SLOT_READ, SLOT_DONE } SlotState;
+typedef struct { uint8_t cells[81]; Verdict verdict; SlotState state; } SolveItem;
+typedef struct {
+  Mutex mu; Cond can_read, can_work, can_write;
+  long read, next, written;    /* lines parsed / next to claim / next to print */
+  bool eof;
+  int window; SolveItem* slot;
+  FILE* in;
+  const Core* core;
+} SolveStream;
+
+/* next puzzle line: 81 cells of 1-9 and '.'/'0'; blank and '#' lines are skipped.
+   Returns false at end of input; malformed lines come back as VERDICT_INVALID. */
+static bool read_puzzle_line(FILE*in,SolveItem*it){
+  char line[128];
+  for(;;){
+    if(!fgets(line,sizeof(line),in)) return false;
+    size_t n=strlen(line); bool whole=(n>0 && line[n-1]=='\n') || feof(in);
+    if(!whole){ int ch; while((ch=fgetc(in))!=EOF && ch!='\n'){} }
+    while(n>0 && (line[n-1]=='\n'||line[n-1]=='\r'||line[n-1]==' '||line[n-1]=='\t')) line[--n]=0;
+    if(n==0 || line[0]=='#') continue;
+    it->verdict=VERDICT_UNIQUE;
+    if(!whole || n!=81){ it->verdict=VERDICT_INVALID; return true; }
+    for(int i=0;i<81;i++){
+      char c=line[i];
+      if(c=='.'||c=='0') it->cells[i]=0;
+      else if(c>='1'&&c<='9') it->cells[i]=(uint8_t)(c-'0');
+      else{ it->verdict=VERDICT_INVALID; break; }
+    }
+    return true;
+  }
+}
+
+static int solve_reader(void*arg){
+  SolveStream*s=(SolveStream*)arg;
+  for(;;){
+    SolveItem it; bool got=read_puzzle_line(s->in,&it);
+    mutex_lock(&s->mu);
+    if(!got){ s->eof=true; cond_broadcast(&s->can_work); cond_signal(&s->can_write); mutex_unlock(&s->mu); return 0; }
+    while(s->read-s->written>=s->window) cond_wait(&s->can_read,&s->mu);
+    it.state=SLOT_READ; s->slot[s->read % s->window]=it; s->read++;
+    cond_signal(&s->can_work);
+    mutex_unlock(&s->mu);
+  }
+}
+
+static int solve_worker(void*arg){
+  SolveStream*s=(SolveStream*)arg;
+  for(;;){
+    mutex_lock(&s->mu);
+    while(s->next>=s->read && !s->eof) cond_wait(&s->can_work,&s->mu);
+    if(s->next>=s->read){ mutex_unlock(&s->mu); return 0; }
+    long k=s->next++;
+    SolveItem it=s->slot[k % s->window];
+    mutex_unlock(&s->mu);
+
+    if(it.verdict!=VERDICT_INVALID){
+      Board b; uint8_t sol[81]; int n=0;
+      if(board_load(&b,it.cells)) n=solver_count(s->core,&b,2,sol);
+      it.verdict = n==1? VERDICT_UNIQUE : n==0? VERDICT_UNSOLVABLE : VERDICT_MULTIPLE;
+      if(n==1) memcpy(it.cells,sol,sizeof(sol));
+    }
+
+    mutex_lock(&s->mu);
+    it.state=SLOT_DONE; s->slot[k % s->window]=it;
+    if(k==s->written) cond_signal(&s->can_write);
+    mutex_unlock(&s->mu);
+  }
+}
 
-/* =================== SUDOKU CORE =================== */
-#define N 9
-#define NN (N*N)
-static inline int IDX(int r,int c){ return r*N + c; }
+/* one line per puzzle: the 81-digit solution, or UNSOLVABLE / MULTIPLE / INVALID */
+static int run_solve(const Core*core,const char*path,int threads,FILE*out){
+  SolveStream s; memset(&s,0,sizeof(s)); s.core=core;
+  s.in = (!path || !strcmp(path,"-"))? stdin : fopen(path,"r");
+  if(!s.in){ fprintf(stderr,"cannot open %s\n",path); return 1; }
+  if(threads<1) threads=cpu_count();
+  s.window=threads*64;
+  s.slot=calloc((size_t)s.window,sizeof(*s.slot));
+  Thread* th=malloc(sizeof(Thread)*(size_t)threads);
+  if(!s.slot||!th){ fprintf(stderr,"out of memory\n"); return 1; }
+  mutex_init(&s.mu); cond_init(&s.can_read); cond_init(&s.can_work); cond_init(&s.can_write);
+  static char outbuf[1<<16]; setvbuf(out,outbuf,_IOFBF,sizeof(outbuf));
+
+  struct timespec t0; timespec_get(&t0,TIME_UTC);
+  Thread reader;
+  if(!thread_start(&reader,solve_reader,&s)){ fprintf(stderr,"could not start reader thread\n"); return 1; }
+  int started=0;
+  for(int t=0;t<threads;t++) if(thread_start(&th[started],solve_worker,&s)) started++;
+  if(!started){ fprintf(stderr,"could not start worker threads\n"); return 1; }
+
+  long tally[4]={0};
+  mutex_lock(&s.mu);
+  for(;;){
+    int k=(int)(s.written % s.window);
+    while(s.slot[k].state!=SLOT_DONE && !(s.eof && s.written==s.read)) cond_wait(&s.can_write,&s.mu);
+    if(s.slot[k].state!=SLOT_DONE) break;
+    SolveItem it=s.slot[k]; s.slot[k].state=SLOT_FREE; s.written++;
+    cond_signal(&s.can_read);
+    mutex_unlock(&s.mu);
+    tally[it.verdict]++;
+    if(it.verdict==VERDICT_UNIQUE){ char line[82]; for(int i=0;i<81;i++) line[i]=(char)('0'+it.cells[i]); line[81]='\n'; fwrite(line,1,82,out); }
+    else{ fputs(VERDICT_NAMES[it.verdict],out); fputc('\n',out); }
+    mutex_lock(&s.mu);
+  }
+  mutex_unlock(&s.mu);
+  thread_join(reader);
+  for(int t=0;t<started;t++) thread_join(th[t]);
+  bool ok = fflush(out)==0 && !ferror(out) && !ferror(s.in);
+  if(!ok) fprintf(stderr,"I/O error while solving\n");
+
+  struct timespec t1; timespec_get(&t1,TIME_UTC);
+  double dt=(double)(t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)*1e-9;
+  char backend[32];   /* DLX never calls the MRV kernel */
+  if(core->solver==SOLVER_DLX) snprintf(backend,sizeof(backend),"dlx");
+  else snprintf(backend,sizeof(backend),"%s MRV",mrv_name(core->find_mrv));
+  fprintf(stderr,"Solved %ld puzzles in %.2f s (%.0f/s, %d threads, %s): %ld unique, %ld unsolvable, %ld multiple, %ld invalid\n",
+          s.written, dt, dt>0? s.written/dt : 0.0, started, backend, tally[0], tally[1], tally[2], tally[3]);
+  if(s.in!=stdin) fclose(s.in);
+  mutex_destroy(&s.mu); cond_destroy(&s.can_read); cond_destroy(&s.can_work); cond_destroy(&s.can_write);
+  free(th); free(s.slot);
+  return ok?0:1;
+}
 
+/* =================== PARALLEL SOLUTION COUNT =================== */
+/* For puzzles with many solutions. The top PCOUNT_SPLIT levels of the MRV search are split
+   into tasks, one board per branch. Each worker owns a deque of tasks: it takes from the
+   bottom (depth first, few boards alive) and, when empty, steals from the top of another
+   deque (the oldest, biggest subtrees). Below the split a task is one serial MRV search that
+   publishes its solutions every PCOUNT_FLUSH, so reaching the limit stops every worker within
+   a few solutions rather than each one using up its own budget.
+   Result is exact below limit and equals limit once it is reached, like count_limit.
+   The workers live for the whole --count run and sleep between puzzles; tasks only touch the
+   deque locks and two atomic counters, and j->mu is taken to go idle or wake someone. */
+#define PCOUNT_SPLIT 6
+#define PCOUNT_DEQUE 256     /* per worker, power of two; a full deque runs the branch inline */
+#define PCOUNT_MIN_OPEN 56   /* fewer open cells: solved serially, splitting costs more than it saves */
+#define PCOUNT_FLUSH 64      /* solutions a subtree counts locally before adding them to the total */
+typedef struct { Board b; int depth; uint64_t key; } CountTask;   /* key: branch path, 4 bits per level */
+typedef struct { Mutex mu; CountTask* t; int top, bottom; } CountDeque;
+struct CountWorker;
 typedef struct {
-  int puzzle[NN];
-  int solution[NN];
-  unsigned char fixed[NN];
-  uint16_t notes[NN]; /* bitmask: bit v (1..9) */
-} Game;
-
-static inline bool row_has(const int*b,int r,int v){ for(int c=0;c<9;c++) if(b[IDX(r,c)]==v) return true; return false; }
-static inline bool col_has(const int*b,int c,int v){ for(int r=0;r<9;r++) if(b[IDX(r,c)]==v) return true; return false; }
-static inline bool box_has(const int*b,int r,int c,int v){
-  int br=(r/3)*3, bc=(c/3)*3;
-  for(int rr=0;rr<3;rr++) for(int cc=0;cc<3;cc++)
-    if(b[IDX(br+rr,bc+cc)]==v) return true;
+  const Core* core; int nw, started, ndq;   /* workers, helper threads, deques allocated */
+  CountDeque* dq; struct CountWorker* cw; Thread* th;
+  Mutex mu; Cond idle, go, done;    /* mu guards job, active, quit and the first solution */
+  unsigned job; int active; bool quit;
+  int limit; volatile long total, pending, idle_n;
+  uint8_t* first; uint64_t first_key; bool have_first;
+} CountJob;
+typedef struct CountWorker { CountJob* j; int w; } CountWorker;
+
+static bool deque_push(CountDeque*d,const CountTask*t){
+  mutex_lock(&d->mu);
+  bool ok=d->bottom-d->top<PCOUNT_DEQUE; if(ok) d->t[d->bottom++ & (PCOUNT_DEQUE-1)]=*t;
+  mutex_unlock(&d->mu); return ok;
+}
+static bool deque_pop(CountDeque*d,CountTask*out){
+  mutex_lock(&d->mu);
+  bool ok=d->bottom>d->top; if(ok) *out=d->t[--d->bottom & (PCOUNT_DEQUE-1)];
+  mutex_unlock(&d->mu); return ok;
+}
+static bool deque_empty(CountDeque*d){ mutex_lock(&d->mu); bool e=d->bottom==d->top; mutex_unlock(&d->mu); return e; }
+static bool deque_steal(CountDeque*d,CountTask*out){
+  mutex_lock(&d->mu);
+  bool ok=d->bottom>d->top; if(ok) *out=d->t[d->top++ & (PCOUNT_DEQUE-1)];
+  mutex_unlock(&d->mu); return ok;
+}
+
+static int count_left(CountJob*j){ long left=j->limit-atom_get(&j->total); return left>0? (int)left : 0; }
+/* the first solution kept is the one earliest in DFS order, as the serial search would return,
+   whenever the count stays below limit; once it is reached, earlier subtrees may be cut short */
+static void count_first(CountJob*j,const uint8_t*sol,uint64_t key){
+  if(!j->first) return;
+  mutex_lock(&j->mu);
+  if(!j->have_first || key<j->first_key){ memcpy(j->first,sol,81); j->first_key=key; j->have_first=true; }
+  mutex_unlock(&j->mu);
+}
+/* count_limit on one subtree below the split; true once the shared total reaches the limit */
+typedef struct { CountJob* j; uint64_t key; int n; bool found; } CountLeaf;
+static bool leaf_flush(CountLeaf*l){ if(l->n){ atom_add(&l->j->total,l->n); l->n=0; } return atom_get(&l->j->total)>=l->j->limit; }
+static bool count_leaf(CountLeaf*l,Board*b){
+  unsigned m; int i=l->j->core->find_mrv(b,&m);
+  if(i<0){
+    if(!l->found){ l->found=true; count_first(l->j,b->cell,l->key); }   /* DFS order: earliest in the subtree */
+    return ++l->n>=PCOUNT_FLUSH && leaf_flush(l);
+  }
+  while(m){
+    int v=lowbit16(m); m&=m-1; board_set(b,i,v); CORE_NODE_HOOK();
+    bool stop=count_leaf(l,b); board_unset(b,i);
+    if(stop) return true;
+  }
   return false;
 }
-static inline bool can_place_local(const int*b,int r,int c,int v){
-  return !row_has(b,r,v)&&!col_has(b,c,v)&&!box_has(b,r,c,v);
-}
-static void shuffle(int *a,int n){ for(int i=n-1;i>0;--i){ int j=rand()%(i+1); int t=a[i]; a[i]=a[j]; a[j]=t; } }
-
-static int find_mrv(const int*b){
-  int best=-1, bc=10;
-  for(int i=0;i<81;i++){
-    if(b[i]) continue;
-    int r=i/9,c=i%9, cnt=0;
-    for(int v=1;v<=9;v++) if(can_place_local(b,r,c,v)) cnt++;
-    if(cnt<bc){ bc=cnt; best=i; if(cnt==1) break; }
-  }
-  return best;
-}
-static bool rec_first(int*b,int*out){
-  int i=find_mrv(b); if(i<0){ memcpy(out,b,81*sizeof(int)); return true; }
-  int r=i/9,c=i%9,opts[9],o=0; for(int v=1;v<=9;v++) if(can_place_local(b,r,c,v)) opts[o++]=v;
-  for(int k=0;k<o;k++){ b[i]=opts[k]; if(rec_first(b,out)) return true; b[i]=0; } return false;
-}
-static int count_limit(int*b,int limit){
-  int i=find_mrv(b); if(i<0) return 1;
-  int r=i/9,c=i%9,opts[9],o=0; for(int v=1;v<=9;v++) if(can_place_local(b,r,c,v)) opts[o++]=v;
-  int tot=0; for(int k=0;k<o;k++){ b[i]=opts[k]; int got=count_limit(b,limit-tot); tot+=got; if(tot>=limit){ b[i]=0; return tot; } b[i]=0; } return tot;
-}
-static bool unique_solution(const int*puz,int*out_sol){
-  int tmp[81]; memcpy(tmp,puz,sizeof(tmp)); if(!rec_first(tmp,out_sol)) return false;
-  memcpy(tmp,puz,sizeof(tmp)); return count_limit(tmp,2)==1;
-}
-
-/* solved grid via pattern + shuffles */
-static void make_solved(int*out){
-  int rows[9]={0,1,2,3,4,5,6,7,8}, cols[9]={0,1,2,3,4,5,6,7,8}, nums[9]={1,2,3,4,5,6,7,8,9};
-  int band[3]={0,1,2}; shuffle(band,3);
-  int rin[3][3]={{0,1,2},{3,4,5},{6,7,8}}; for(int b=0;b<3;b++) shuffle(rin[b],3);
-  int p=0; for(int b0=0;b0<3;b0++){ int bi=band[b0]; for(int i=0;i<3;i++) rows[p++]=rin[bi][i]; }
-  int stack_[3]={0,1,2}; shuffle(stack_,3);
-  int cin[3][3]={{0,1,2},{3,4,5},{6,7,8}}; for(int s=0;s<3;s++) shuffle(cin[s],3);
-  p=0; for(int s0=0;s0<3;s0++){ int si=stack_[s0]; for(int i=0;i<3;i++) cols[p++]=cin[si][i]; }
-  shuffle(nums,9);
-  for(int r=0;r<9;r++) for(int c=0;c<9;c++){
-    int r2=rows[r], c2=cols[c];
-    int base=(r2*3 + r2/3 + c2) % 9;
-    out[IDX(r,c)]=nums[base];
-  }
-}
-
-/* remove clues to medium difficulty; unique-solution enforced */
-static void remove_to_medium(int*grid){
-  int minC=32,maxC=38;
-  int pos[81]; for(int i=0;i<81;i++) pos[i]=i; shuffle(pos,81);
-  int clues=81;
-  for(int k=0;k<81;k++){
-    int i=pos[k]; int r=i/9,c=i%9; int j=IDX(8-r,8-c);
-    if(grid[i]==0 && grid[j]==0) continue;
-    int bi=grid[i], bj=grid[j]; grid[i]=0; if(j!=i) grid[j]=0;
-    int tmp[81]; memcpy(tmp,grid,sizeof(tmp)); int sol[81];
-    bool ok=unique_solution(tmp,sol);
-    int delta=(j==i)?1:2;
-    if(!ok || (clues-delta)<minC){ grid[i]=bi; if(j!=i) grid[j]=bj; }
-    else{ clues-=delta; if(clues<=maxC){ if(rand()%3==0) break; } }
-  }
-}
-
-static void new_game(Game*g,unsigned seed){
-  if(seed) srand(seed); else srand((unsigned)time(NULL));
-  int solved[81]; make_solved(solved);
-  int puzzle[81]; memcpy(puzzle,solved,sizeof(puzzle));
-  remove_to_medium(puzzle);
-  int finalSol[81];
-  if(!unique_solution(puzzle,finalSol)){
-    int safe[81]={
-      5,3,0, 0,7,0, 0,0,0,
-      6,0,0, 1,9,5, 0,0,0,
-      0,9,8, 0,0,0, 0,6,0,
-      8,0,0, 0,6,0, 0,0,3,
-      4,0,0, 8,0,3, 0,0,1,
-      7,0,0, 0,2,0, 0,0,6,
-      0,6,0, 0,0,0, 2,8,0,
-      0,0,0, 4,1,9, 0,0,5,
-      0,0,0, 0,8,0, 0,7,9
-    };
-    memcpy(puzzle,safe,sizeof(safe)); unique_solution(puzzle,finalSol);
-  }
-  for(int i=0;i<81;i++){ g->puzzle[i]=puzzle[i]; g->solution[i]=finalSol[i]; g->fixed[i]=(puzzle[i]!=0); g->notes[i]=0; }
-}
-static bool is_solved(const Game*g){
-  for(int i=0;i<81;i++){ if(g->puzzle[i]==0) return false; if(g->puzzle[i]!=g->solution[i]) return false; } return true;
-}
-static bool place(Game*g,int r,int c,int v,bool strict){
-  if(g->fixed[IDX(r,c)]) return false;
-  if(v==0){ g->puzzle[IDX(r,c)]=0; g->notes[IDX(r,c)]=0; return true; }
-  if(strict && !can_place_local(g->puzzle,r,c,v)) return false;
-  g->puzzle[IDX(r,c)]=v; g->notes[IDX(r,c)]=0; return true;
-}
-static bool give_hint(Game*g,int r,int c){
-  if(g->fixed[IDX(r,c)]) return false;
-  int corr=g->solution[IDX(r,c)];
-  if(g->puzzle[IDX(r,c)]==corr) return false;
-  g->puzzle[IDX(r,c)]=corr; g->notes[IDX(r,c)]=0; return true;
-}
-static bool has_conflict(const Game*g,int rr,int cc,int v){
-  if(v==0) return false;
-  for(int c=0;c<9;c++) if(c!=cc && g->puzzle[IDX(rr,c)]==v) return true;
-  for(int r=0;r<9;r++) if(r!=rr && g->puzzle[IDX(r,cc)]==v) return true;
-  int br=(rr/3)*3, bc=(cc/3)*3;
-  for(int r=0;r<3;r++) for(int c=0;c<3;c++){
-    int R=br+r, C=bc+c; if(R==rr&&C==cc) continue; if(g->puzzle[IDX(R,C)]==v) return true;
-  } return false;
-}
-static int count_conflicts(const Game*g){
-  int cnt=0; for(int r=0;r<9;r++) for(int c=0;c<9;c++){ int v=g->puzzle[IDX(r,c)]; if(v && has_conflict(g,r,c,v)) cnt++; } return cnt;
+static void count_wake(CountJob*j){ mutex_lock(&j->mu); cond_broadcast(&j->idle); mutex_unlock(&j->mu); }
+static void count_task(CountJob*j,int w,const CountTask*t){
+  if(count_left(j)<=0) return;
+  if(t->depth>=PCOUNT_SPLIT){ CountLeaf l={j,t->key,0,false}; Board b=t->b; count_leaf(&l,&b); leaf_flush(&l); return; }
+  unsigned m; int i=j->core->find_mrv(&t->b,&m);
+  if(i<0){ atom_add(&j->total,1); count_first(j,t->b.cell,t->key); return; }
+  /* children go on the bottom in reverse, so the owner continues with the first branch */
+  int vs[9], nv=0; while(m){ vs[nv++]=lowbit16(m); m&=m-1; }
+  for(int c=nv-1;c>=0;c--){
+    CountTask ch=*t; board_set(&ch.b,i,vs[c]); ch.depth++; ch.key=t->key | (uint64_t)(c+1)<<(60-4*t->depth);
+    /* pending goes up before the push, so a thief finishing the child early never sees 0 */
+    atom_add(&j->pending,1);
+    if(!deque_push(&j->dq[w],&ch)){ count_task(j,w,&ch); atom_add(&j->pending,-1); }
+    else if(atom_add(&j->idle_n,0)>0) count_wake(j);   /* read-modify-write: pairs with the sleeper's */
+  }
+}
+/* runs tasks of the current puzzle until none is queued or running */
+static void count_drain(CountJob*j,int w){
+  for(;;){
+    CountTask t;
+    bool got=deque_pop(&j->dq[w],&t);
+    for(int k=1;!got && k<j->nw;k++) got=deque_steal(&j->dq[(w+k)%j->nw],&t);
+    if(got){
+      count_task(j,w,&t);
+      if(atom_add(&j->pending,-1)==0) count_wake(j);
+      continue;
+    }
+    if(atom_get(&j->pending)==0) return;
+    /* going idle: announce it, then re-check under j->mu so a push or the last task ending
+       between the scan above and the wait is not missed */
+    mutex_lock(&j->mu);
+    atom_add(&j->idle_n,1);
+    bool done=atom_add(&j->pending,0)==0, queued=false;
+    for(int k=0;!done && !queued && k<j->nw;k++) queued=!deque_empty(&j->dq[k]);
+    if(!done && !queued) cond_wait(&j->idle,&j->mu);
+    atom_add(&j->idle_n,-1);
+    mutex_unlock(&j->mu);
+    if(done) return;
+  }
+}
+static int count_helper(void*arg){
+  CountWorker* cw=(CountWorker*)arg; CountJob* j=cw->j; unsigned seen=0;
+  mutex_lock(&j->mu);
+  for(;;){
+    while(!j->quit && j->job==seen) cond_wait(&j->go,&j->mu);
+    if(j->quit) break;
+    seen=j->job;
+    mutex_unlock(&j->mu);
+    count_drain(j,cw->w);
+    mutex_lock(&j->mu);
+    if(--j->active==0) cond_signal(&j->done);
+  }
+  mutex_unlock(&j->mu);
+  return 0;
+}
+/* `threads` workers in all, the caller of count_run being one of them; with fewer than two
+   (or on failure) every puzzle is counted serially */
+static void count_start(CountJob*j,const Core*core,int threads){
+  memset(j,0,sizeof(*j)); j->core=core; j->nw=1;
+  mutex_init(&j->mu); cond_init(&j->idle); cond_init(&j->go); cond_init(&j->done);
+  if(threads<2) return;
+  j->dq=(CountDeque*)calloc((size_t)threads,sizeof(CountDeque)); if(j->dq) j->ndq=threads;
+  j->cw=(CountWorker*)malloc(sizeof(CountWorker)*(size_t)threads);
+  j->th=(Thread*)malloc(sizeof(Thread)*(size_t)threads);
+  bool ok=j->dq && j->cw && j->th;
+  for(int w=0;ok && w<threads;w++){ j->dq[w].t=(CountTask*)malloc(sizeof(CountTask)*PCOUNT_DEQUE); ok=j->dq[w].t!=NULL; if(ok) mutex_init(&j->dq[w].mu); }
+  for(int w=1;ok && w<threads;w++){
+    CountWorker* cw=&j->cw[j->started+1]; cw->j=j; cw->w=j->started+1;
+    if(thread_start(&j->th[j->started],count_helper,cw)) j->started++;
+  }
+  j->nw=j->started+1;
+}
+static void count_stop(CountJob*j){
+  mutex_lock(&j->mu); j->quit=true; cond_broadcast(&j->go); mutex_unlock(&j->mu);
+  for(int t=0;t<j->started;t++) thread_join(j->th[t]);
+  for(int w=0;j->dq && w<j->ndq;w++) if(j->dq[w].t){ free(j->dq[w].t); mutex_destroy(&j->dq[w].mu); }
+  free(j->dq); free(j->cw); free(j->th);
+  mutex_destroy(&j->mu); cond_destroy(&j->idle); cond_destroy(&j->go); cond_destroy(&j->done);
+}
+/* solutions of b up to limit on the started workers */
+static int count_run(CountJob*j,const Board*b,int limit,uint8_t*first){
+  int open=0; for(int i=0;i<NN;i++) open+=!b->cell[i];
+  if(!j->started || open<PCOUNT_MIN_OPEN) return solver_count(j->core,b,limit,first);
+  j->limit=limit; j->total=0; j->pending=1; j->first=first; j->have_first=false;
+  CountTask root; root.b=*b; root.depth=0; root.key=0;
+  deque_push(&j->dq[0],&root);
+  mutex_lock(&j->mu); j->job++; j->active=j->started; cond_broadcast(&j->go); mutex_unlock(&j->mu);
+  count_drain(j,0);
+  mutex_lock(&j->mu); while(j->active) cond_wait(&j->done,&j->mu); mutex_unlock(&j->mu);
+  return j->total<limit? (int)j->total : limit;
+}
+
+/* --count: one line per puzzle with its number of solutions, ">=LIMIT" once the limit is
+   reached, or INVALID; puzzles go one at a time, each counted on all workers */
+static int run_count(const Core*core,const char*path,int threads,int limit,FILE*out){
+  FILE* in = (!path || !strcmp(path,"-"))? stdin : fopen(path,"r");
+  if(!in){ fprintf(stderr,"cannot open %s\n",path); return 1; }
+  if(threads<1) threads=cpu_count();
+  if(limit<1) limit=1;
+  CountJob cj; count_start(&cj,core,threads);
+  struct timespec t0; timespec_get(&t0,TIME_UTC);
+  SolveItem it; long puzzles=0, capped=0;
+  while(read_puzzle_line(in,&it)){
+    puzzles++;
+    if(it.verdict==VERDICT_INVALID){ fputs("INVALID\n",out); continue; }
+    Board b; int n = board_load(&b,it.cells)? count_run(&cj,&b,limit,NULL) : 0;
+    if(n>=limit){ capped++; fprintf(out,">=%d\n",limit); } else fprintf(out,"%d\n",n);
+  }
+  bool ok = fflush(out)==0 && !ferror(out) && !ferror(in);
+  if(!ok) fprintf(stderr,"I/O error while counting\n");
+  struct timespec t1; timespec_get(&t1,TIME_UTC);
+  double dt=(double)(t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)*1e-9;
+  fprintf(stderr,"Counted %ld puzzles in %.2f s (%d threads, limit %d): %ld reached the limit\n", puzzles, dt, cj.nw, limit, capped);
+  count_stop(&cj);
+  if(in!=stdin) fclose(in);
+  return ok?0:1;
+}
+
+/* =================== FRAME PROFILER =================== */
+/* Wall time per main-loop phase (performance counter). The last PROF_FRAMES frames feed the
+   F3 overlay; with --trace every phase is also streamed as a Chrome trace "X" event (µs),
+   loadable in chrome://tracing or Perfetto. A frame is the work between two presents:
+   events + logic + screen + present (layer..toast are nested inside screen). */
+typedef enum { PH_EVENTS, PH_LOGIC, PH_SCREEN, PH_PRESENT, PH_LAYER, PH_BOARD, PH_NOTES, PH_SIDEBAR, PH_TOAST, PH_COUNT } Phase;
+static const char* const phase_name[PH_COUNT]={"events","logic","screen","present","layer","board","notes","sidebar","toast"};
+#define PROF_FRAMES 240
+#define HUD_TEXT_LEN 512   /* F3 summary; also the size of a cached text slot */
+typedef struct {
+  uint64_t freq, t0, open[PH_COUNT];
+  double cur[PH_COUNT];                         /* ms spent in each phase this frame */
+  float frame_ms[PROF_FRAMES], phase_ms[PROF_FRAMES][PH_COUNT], input_ms[PROF_FRAMES];
+  int nframe, ninput;                           /* totals; rings index with % PROF_FRAMES */
+  Uint32 input_ts; bool input_pending;          /* oldest input event not yet presented */
+  FILE* trace; long trace_events;
+  bool hud; double hud_t; char hud_text[HUD_TEXT_LEN];
+} Prof;
+
+static double prof_us(const Prof*p,uint64_t ticks){ return (double)ticks*1e6/(double)p->freq; }
+static void prof_emit(Prof*p,const char*name,int tid,uint64_t a,uint64_t b){
+  if(!p->trace) return;
+  fprintf(p->trace,"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f}",
+          p->trace_events++? ",\n":"", name, tid, prof_us(p,a-p->t0), prof_us(p,b-a));
+}
+static bool prof_init(Prof*p,const char*trace_path){
+  p->freq=SDL_GetPerformanceFrequency(); p->t0=SDL_GetPerformanceCounter();
+  if(!trace_path) return true;
+  p->trace=fopen(trace_path,"w"); if(!p->trace) return false;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n",p->trace);
+  fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"frame phases\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"input to present\"}}",p->trace);
+  p->trace_events=1; return true;
+}
+static void prof_close(Prof*p){ if(p->trace){ fputs("\n]}\n",p->trace); fclose(p->trace); p->trace=NULL; } }
+static void prof_begin(Prof*p,Phase ph){ p->open[ph]=SDL_GetPerformanceCounter(); }
+static void prof_end(Prof*p,Phase ph){
+  uint64_t t=SDL_GetPerformanceCounter();
+  p->cur[ph]+=(double)(t-p->open[ph])*1000.0/(double)p->freq;
+  prof_emit(p,phase_name[ph],1,p->open[ph],t);
+}
+static void prof_input(Prof*p,Uint32 timestamp){ if(!p->input_pending){ p->input_pending=true; p->input_ts=timestamp; } }
+/* after SDL_RenderPresent: close the frame and the pending input-to-present interval */
+static void prof_frame_done(Prof*p){
+  int k=p->nframe++ % PROF_FRAMES;
+  p->frame_ms[k]=(float)(p->cur[PH_EVENTS]+p->cur[PH_LOGIC]+p->cur[PH_SCREEN]+p->cur[PH_PRESENT]);
+  for(int i=0;i<PH_COUNT;i++){ p->phase_ms[k][i]=(float)p->cur[i]; p->cur[i]=0; }
+  if(p->input_pending){
+    Uint32 lat=SDL_GetTicks()-p->input_ts; uint64_t t=SDL_GetPerformanceCounter();
+    p->input_ms[p->ninput++ % PROF_FRAMES]=(float)lat;
+    prof_emit(p,"input",2,t-(uint64_t)((double)lat*(double)p->freq/1000.0),t);
+    p->input_pending=false;
+  }
+}
+static int cmp_float(const void*a,const void*b){ float x=*(const float*)a, y=*(const float*)b; return (x>y)-(x<y); }
+/* p50/p95/p99/max of a ring, in out[4] */
+static void prof_percentiles(const float*ring,int total,float out[4]){
+  int n = total<PROF_FRAMES? total : PROF_FRAMES; float tmp[PROF_FRAMES];
+  if(n==0){ out[0]=out[1]=out[2]=out[3]=0; return; }
+  memcpy(tmp,ring,(size_t)n*sizeof *tmp); qsort(tmp,(size_t)n,sizeof *tmp,cmp_float);
+  out[0]=tmp[n*50/100]; out[1]=tmp[n*95/100]; out[2]=tmp[n*99/100]; out[3]=tmp[n-1];
+}
+static void prof_summary(const Prof*p,char*buf,size_t cap){
+  int n = p->nframe<PROF_FRAMES? p->nframe : PROF_FRAMES; float f[4], in[4]; double mean[PH_COUNT]={0};
+  prof_percentiles(p->frame_ms,p->nframe,f); prof_percentiles(p->input_ms,p->ninput,in);
+  for(int k=0;k<n;k++) for(int i=0;i<PH_COUNT;i++) mean[i]+=p->phase_ms[k][i];
+  for(int i=0;i<PH_COUNT;i++) mean[i]/= n? n : 1;
+  int len=snprintf(buf,cap,"frame ms  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f  (%d frames)\n", f[0],f[1],f[2],f[3], n);
+  for(int i=0;i<PH_COUNT && len>0 && (size_t)len<cap;i++)
+    len+=snprintf(buf+len,cap-(size_t)len,"%s%s %.2f%s", i==PH_LAYER?"  ":"", phase_name[i], mean[i], i==PH_PRESENT||i==PH_COUNT-1? "\n" : "   ");
+  if(len>0 && (size_t)len<cap)
+    snprintf(buf+len,cap-(size_t)len,"input->present ms  p50 %.0f  p99 %.0f  max %.0f", in[0],in[2],in[3]);
 }
 
 /* =================== GUI & THEME =================== */
-typedef struct { SDL_Window* win; SDL_Renderer* ren; TTF_Font* font_big; TTF_Font* font_small; int width, height; } Gfx;
+/* cell labels 1..MAX_SIDE of both fonts, rasterized once in white and tinted per draw */
+typedef struct { SDL_Texture* tex; int w, h; SDL_Rect big[MAX_SIDE+1], small[MAX_SIDE+1]; } GlyphAtlas;
+/* per-frame primitive batch: quads (4 vertices, 6 indices each) sharing one texture or none */
+typedef struct { SDL_Vertex* v; int* idx; int nq, cap; SDL_Texture* tex; } Batch;
+/* retained layers: the static part of a screen (background, grid, buttons, labels, wrapped
+   text) drawn once into a window-sized render target, redrawn only when its key changes */
+typedef enum { LAYER_PLAY, LAYER_TITLE, LAYER_HELP, LAYER_ABOUT, LAYER_COUNT } LayerId;
+typedef struct { int w, h, dark, mode, box; } LayerKey;
+typedef struct { SDL_Texture* tex; int w, h; LayerKey key; bool valid; } Layer;
+/* per-frame strings (timer, counters, toast): re-rasterized only when the text changes */
+typedef enum { TXT_TIME, TXT_LIMIT, TXT_PROGRESS, TXT_TOAST, TXT_HUD, TXT_COUNT } TextId;
+typedef struct { SDL_Texture* tex; int w, h, wrap; TTF_Font* font; SDL_Color col; char s[HUD_TEXT_LEN]; } TextSlot;
+typedef struct {
+  SDL_Window* win; SDL_Renderer* ren; TTF_Font* font_big; TTF_Font* font_small; int width, height;
+  GlyphAtlas atlas; Batch batch; bool targets; Prof prof; Layer layer[LAYER_COUNT]; TextSlot text[TXT_COUNT];
+} Gfx;
 
 typedef struct {
   SDL_Color bg, board, thin, thick, hover, sel, sel_outline, text_given, text_edit, text_wrong, boxhl, samehl, shadow, btn, btnfg, dim, title, palette_bg, palette_fg, conflict;
@@ -222,6 +698,7 @@ typedef enum {RES_NONE=0, RES_WIN=1, RES_LOSE=2} Result;
 typedef struct {
   int sel_r, sel_c;
   bool notes_mode, strict_mode, paused, dark_theme;
+  bool auto_notes, auto_prune;   /* pencil marks follow the board: full candidates / pruning only */
 
   int mistakes, strikes, strikes_max;
   double start_t, pause_t0, paused_accum;
@@ -230,18 +707,94 @@ typedef struct {
   char toast[96]; double toast_t0; bool toast_on;
 
   Screen screen; Screen prev_screen; Mode mode; Result result;
+  int box;   /* board size for new games: 2 (4x4), 3 (9x9), 4 (16x16), 5 (25x25) */
+  bool starting;   /* a new game was asked for and the prefetch queue is still empty */
 } UI;
 
 static double now_s(void){ return SDL_GetTicks()*0.001; }
 static double elapsed_time(const UI*ui){
   double now=now_s(); return ui->paused? (ui->pause_t0-ui->start_t-ui->paused_accum) : (now-ui->start_t-ui->paused_accum);
 }
+/* Redraw scheduling: the main loop sleeps in SDL_WaitEventTimeout until an event arrives or
+   the next timed change is due: the timer label's next second, the toast expiry and, while
+   the window has focus, the selection pulse at PULSE_FPS. While a game is being generated the
+   loop polls the prefetch queue at PULSE_FPS. */
+#define PULSE_FPS 20
+static double next_redraw_due(const UI*ui,double now,bool animate){
+  double due=now+60.0;
+  if(ui->starting) due=now+1.0/PULSE_FPS;
+  if((ui->screen==SCR_PLAY || ui->screen==SCR_END) && !ui->paused){
+    double d=now+(1.0-fmod(elapsed_time(ui),1.0))+0.005; if(d<due) due=d;
+  }
+  if(ui->screen==SCR_PLAY){
+    if(ui->toast_on){ double d=ui->toast_t0+2.2+0.005; if(d<due) due=d; }
+    if(animate){ double d=now+1.0/PULSE_FPS; if(d<due) due=d; }
+  }
+  return due;
+}
 static void show_toast(UI*ui,const char*msg){ snprintf(ui->toast,sizeof(ui->toast),"%s",msg); ui->toast_t0=now_s(); ui->toast_on=true; }
+static void clamp_selection(UI*ui,const Game*g){ if(ui->sel_r>=g->side) ui->sel_r=g->side/2; if(ui->sel_c>=g->side) ui->sel_c=g->side/2; }
 static void set_mode_params(UI*ui){
   ui->strikes=0; ui->strikes_max=3;
   ui->time_limit_s = (ui->mode==MODE_TIME ? 10*60 : 0);
 }
 
+/* ===== Puzzle prefetch: a background thread keeps a few ready games ===== */
+/* Games do not depend on the mode (begin_play applies it), so one ring serves all three. */
+#define PREFETCH_DEPTH 3
+typedef struct {
+  Mutex mu; Cond wake;
+  Game q[PREFETCH_DEPTH]; int head, count;   /* all boards of size box */
+  int box;
+  uint64_t seed, serial;
+  bool quit, running; Thread th;
+  const Core* core;
+} Prefetch;
+
+static int prefetch_worker(void*arg){
+  Prefetch*p=(Prefetch*)arg;
+  mutex_lock(&p->mu);
+  for(;;){
+    if(p->quit) break;
+    if(p->count==PREFETCH_DEPTH){ cond_wait(&p->wake,&p->mu); continue; }
+    Rng rng=rng_make(p->seed,p->serial++); int box=p->box;
+    mutex_unlock(&p->mu);
+    Game g; new_game(p->core,box,&g,&rng);
+    mutex_lock(&p->mu);
+    if(p->box==box && p->count<PREFETCH_DEPTH){ p->q[(p->head+p->count)%PREFETCH_DEPTH]=g; p->count++; }
+  }
+  mutex_unlock(&p->mu);
+  return 0;
+}
+static void prefetch_start(Prefetch*p,const Core*core,int box,uint64_t seed){
+  memset(p,0,sizeof(*p)); p->seed=seed; p->core=core; p->box=box;
+  mutex_init(&p->mu); cond_init(&p->wake);
+  p->running=thread_start(&p->th,prefetch_worker,p);
+}
+/* board size changed: drop the queued games and refill with the new size */
+static void prefetch_resize(Prefetch*p,int box){
+  mutex_lock(&p->mu);
+  if(p->box!=box){ p->box=box; p->head=p->count=0; cond_signal(&p->wake); }
+  mutex_unlock(&p->mu);
+}
+static void prefetch_stop(Prefetch*p){
+  if(p->running){ mutex_lock(&p->mu); p->quit=true; cond_signal(&p->wake); mutex_unlock(&p->mu); thread_join(p->th); }
+  mutex_destroy(&p->mu); cond_destroy(&p->wake);
+}
+/* pops a ready game without blocking; false while the ring is empty. Only generates in place
+   if the thread failed to start. */
+static bool next_game(Prefetch*p,Game*out){
+  bool got=false, gen=false; Rng rng; int box;
+  mutex_lock(&p->mu);
+  if(p->count>0){ *out=p->q[p->head]; p->head=(p->head+1)%PREFETCH_DEPTH; p->count--; got=true; }
+  else if(!p->running){ rng=rng_make(p->seed,p->serial++); gen=true; }
+  box=p->box;
+  cond_signal(&p->wake);
+  mutex_unlock(&p->mu);
+  if(gen) new_game(p->core,box,out,&rng);
+  return got || gen;
+}
+
 /* ===== Font discovery (robust, cross-platform) ===== */
 static bool ends_withi(const char* s, const char* suf){
   size_t ns=strlen(s), ms=strlen(suf); if(ms>ns) return false;
@@ -253,8 +806,22 @@ static bool ends_withi(const char* s, const char* suf){
   }
   return true;
 }
+/* Candidates are accepted by their sfnt header (TrueType 0x00010000 / "true", CFF "OTTO",
+   collection "ttcf") rather than a full FreeType open; main() falls back to full opens
+   (font_full_open) if the chosen file still fails to load. */
+static bool font_full_open=false;
+static bool probe_font_file(const char* path){
+  FILE* f=fopen(path,"rb"); if(!f) return false;
+  unsigned char h[12]; size_t n=fread(h,1,sizeof h,f); fclose(f);
+  if(n<sizeof h) return false;
+  uint32_t tag=((uint32_t)h[0]<<24)|((uint32_t)h[1]<<16)|((uint32_t)h[2]<<8)|h[3];
+  if(tag==0x74746366u) return true;                                   /* "ttcf" */
+  int tables=(h[4]<<8)|h[5];
+  return (tag==0x00010000u || tag==0x4F54544Fu || tag==0x74727565u) && tables>0 && tables<256;
+}
 static bool try_open_font_path(const char* path){
   if(!path) return false;
+  if(!font_full_open) return probe_font_file(path);
   TTF_Font* tmp = TTF_OpenFont(path, 18);
   if(tmp){ TTF_CloseFont(tmp); return true; }
   return false;
@@ -287,42 +854,127 @@ static bool try_candidates(char out[PATH_MAX], const char* name){
   return false;
 }
 
+/* Deep scan, last resort: breadth-first over the font roots, at most FONT_SCAN_DEPTH levels
+   and FONT_SCAN_DIRS directories, listed by a few threads. The winner is the file whose name
+   comes first in the preferred list (then the smallest path), so the result does not depend
+   on thread timing; finding the top preference ends the scan early. */
+#define FONT_SCAN_DEPTH   4
+#define FONT_SCAN_DIRS    1024
+#define FONT_SCAN_THREADS 4
+typedef struct {
+  char* dir[FONT_SCAN_DIRS]; unsigned char depth[FONT_SCAN_DIRS];
+  int head, tail, busy; bool found; char out[PATH_MAX];
+  const char* const* pref; int npref, rank;      /* rank of out: index in pref, npref = other */
+  Mutex mu; Cond cv;
+} FontScan;
+static void font_scan_push(FontScan*s,const char*dir,int depth){
+  mutex_lock(&s->mu);
+  if(!s->found && s->tail<FONT_SCAN_DIRS && depth<=FONT_SCAN_DEPTH){
+    char* d=(char*)malloc(strlen(dir)+1);
+    if(d){ strcpy(d,dir); s->dir[s->tail]=d; s->depth[s->tail]=(unsigned char)depth; s->tail++; cond_signal(&s->cv); }
+  }
+  mutex_unlock(&s->mu);
+}
+static bool font_scan_done(FontScan*s){ mutex_lock(&s->mu); bool f=s->found; mutex_unlock(&s->mu); return f; }
+static void font_scan_file(FontScan*s,const char*path,const char*name){
+  if(!(ends_withi(name,".ttf") || ends_withi(name,".otf")) || !try_open_font_path(path)) return;
+  int rank=s->npref; while(rank>0 && strcmp(name,s->pref[rank-1])!=0) rank--;
+  rank = rank>0? rank-1 : s->npref;
+  mutex_lock(&s->mu);
+  if(!s->out[0] || rank<s->rank || (rank==s->rank && strcmp(path,s->out)<0)){
+    s->rank=rank; snprintf(s->out,sizeof s->out,"%s",path);
+    if(rank==0){ s->found=true; cond_broadcast(&s->cv); }
+  }
+  mutex_unlock(&s->mu);
+}
+static void font_scan_dir(FontScan*s,const char*dir,int depth){
 #if defined(_WIN32)
-static bool search_dir_win(const char* dir, char out[PATH_MAX]){
   char pattern[PATH_MAX]; snprintf(pattern,sizeof(pattern), "%s\\*.*", dir);
-  WIN32_FIND_DATAA fd; HANDLE h=FindFirstFileA(pattern,&fd); if(h==INVALID_HANDLE_VALUE) return false;
+  WIN32_FIND_DATAA fd; HANDLE h=FindFirstFileA(pattern,&fd); if(h==INVALID_HANDLE_VALUE) return;
   do{
-    if(strcmp(fd.cFileName,".")==0 || strcmp(fd.cFileName,"..")==0) continue;
+    if(fd.cFileName[0]=='.') continue;
     char path[PATH_MAX]; snprintf(path,sizeof(path), "%s\\%s", dir, fd.cFileName);
-    if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){
-      if(search_dir_win(path,out)){ FindClose(h); return true; }
-    }else{
-      if(ends_withi(path,".ttf") || ends_withi(path,".otf")){
-        if(try_open_font_path(path)){ strncpy(out,path,PATH_MAX); out[PATH_MAX-1]=0; FindClose(h); return true; }
-      }
-    }
-  }while(FindNextFileA(h,&fd));
-  FindClose(h); return false;
-}
+    if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) font_scan_push(s,path,depth+1);
+    else font_scan_file(s,path,fd.cFileName);
+  }while(!font_scan_done(s) && FindNextFileA(h,&fd));
+  FindClose(h);
 #else
-static bool search_dir_posix(const char* dir, char out[PATH_MAX]){
-  DIR* d=opendir(dir); if(!d) return false;
+  DIR* d=opendir(dir); if(!d) return;
   struct dirent* ent;
-  while((ent=readdir(d))){
+  while(!font_scan_done(s) && (ent=readdir(d))){
     if(ent->d_name[0]=='.') continue;
     char path[PATH_MAX]; snprintf(path,sizeof(path), "%s/%s", dir, ent->d_name);
-    struct stat st; if(stat(path,&st)!=0) continue;
-    if(S_ISDIR(st.st_mode)){
-      if(search_dir_posix(path,out)){ closedir(d); return true; }
-    }else{
-      if(ends_withi(path,".ttf") || ends_withi(path,".otf")){
-        if(try_open_font_path(path)){ strncpy(out,path,PATH_MAX); out[PATH_MAX-1]=0; closedir(d); return true; }
-      }
-    }
+    bool is_dir;
+# if defined(DT_DIR)
+    if(ent->d_type==DT_DIR) is_dir=true;
+    else if(ent->d_type==DT_REG) is_dir=false;
+    else
+# endif
+    { struct stat st; if(stat(path,&st)!=0) continue; is_dir=S_ISDIR(st.st_mode); }
+    if(is_dir) font_scan_push(s,path,depth+1); else font_scan_file(s,path,ent->d_name);
   }
-  closedir(d); return false;
-}
+  closedir(d);
 #endif
+}
+static int font_scan_worker(void*arg){
+  FontScan* s=(FontScan*)arg;
+  mutex_lock(&s->mu);
+  for(;;){
+    while(!s->found && s->head==s->tail && s->busy>0) cond_wait(&s->cv,&s->mu);
+    if(s->found || s->head==s->tail) break;        /* found, or queue drained with nobody listing */
+    int k=s->head++; s->busy++;
+    mutex_unlock(&s->mu);
+    font_scan_dir(s,s->dir[k],s->depth[k]);
+    mutex_lock(&s->mu);
+    s->busy--; cond_broadcast(&s->cv);
+  }
+  mutex_unlock(&s->mu); return 0;
+}
+static bool font_scan(const char* const* roots,int nroots,const char* const* pref,int npref,char out[PATH_MAX]){
+  FontScan* s=(FontScan*)calloc(1,sizeof *s); if(!s) return false;
+  s->pref=pref; s->npref=npref; s->rank=npref;
+  mutex_init(&s->mu); cond_init(&s->cv);
+  for(int i=0;i<nroots;i++) if(roots[i] && roots[i][0]) font_scan_push(s,roots[i],0);
+  int nt=cpu_count(); if(nt>FONT_SCAN_THREADS) nt=FONT_SCAN_THREADS;
+  Thread th[FONT_SCAN_THREADS]; int started=0;
+  for(int i=1;i<nt;i++) if(thread_start(&th[started],font_scan_worker,s)) started++;
+  font_scan_worker(s);
+  for(int i=0;i<started;i++) thread_join(th[i]);
+  bool ok=s->out[0]!=0; if(ok) snprintf(out,PATH_MAX,"%s",s->out);
+  for(int i=0;i<s->tail;i++) free(s->dir[i]);
+  mutex_destroy(&s->mu); cond_destroy(&s->cv); free(s);
+  return ok;
+}
+
+/* Resolved system font, cached per user (SDL pref dir) and trusted on the next launch only
+   if the file still has the recorded size and mtime and a valid sfnt header. */
+static bool pref_file(const char*name,char out[PATH_MAX]){
+  char* pref=SDL_GetPrefPath("Sudokura","Sudokura"); if(!pref) return false;
+  snprintf(out,PATH_MAX,"%s%s",pref,name); SDL_free(pref); return true;
+}
+static bool font_cache_file(char out[PATH_MAX]){ return pref_file("font.cache",out); }
+static bool font_stat(const char*path,long long*size,long long*mtime){
+  struct stat st; if(stat(path,&st)!=0) return false;
+  *size=(long long)st.st_size; *mtime=(long long)st.st_mtime; return true;
+}
+static bool font_cache_load(char out[PATH_MAX]){
+  char cf[PATH_MAX]; if(!font_cache_file(cf)) return false;
+  FILE* f=fopen(cf,"r"); if(!f) return false;
+  long long size=0, mtime=0, s2, m2; char path[PATH_MAX];
+  bool ok = fscanf(f,"SKFONT1 %lld %lld ",&size,&mtime)==2 && fgets(path,sizeof path,f)!=NULL;
+  fclose(f);
+  if(!ok) return false;
+  path[strcspn(path,"\r\n")]=0;
+  if(!path[0] || !font_stat(path,&s2,&m2) || s2!=size || m2!=mtime || !try_open_font_path(path)) return false;
+  snprintf(out,PATH_MAX,"%s",path); return true;
+}
+static void font_cache_store(const char*path){
+  char cf[PATH_MAX]; long long size, mtime;
+  if(!font_cache_file(cf) || !font_stat(path,&size,&mtime)) return;
+  FILE* f=fopen(cf,"w"); if(!f) return;
+  fprintf(f,"SKFONT1 %lld %lld\n%s\n",size,mtime,path); fclose(f);
+}
+static void font_cache_clear(void){ char cf[PATH_MAX]; if(font_cache_file(cf)) remove(cf); }
 
 /* === NUEVO: helpers para localizar el directorio del ejecutable y probar fuentes locales === */
 static bool get_exe_dir(char out[PATH_MAX]) {
@@ -390,54 +1042,261 @@ static const char* find_font_path_dynamic(char out[PATH_MAX], const char* cli){
     if(have_exe_dir && try_in_dir(exedir, local_first[i], out)) return out;
   }
 
-  /* 2) Preferidas en ubicaciones conocidas del sistema */
+  /* 2) Resultado cacheado de un arranque anterior */
+  if(font_cache_load(out)) return out;
+
+  /* 3) Preferidas en ubicaciones conocidas del sistema */
   const char* preferred[]={
     "DejaVuSans.ttf","DejaVuSans-Regular.ttf","NotoSans-Regular.ttf","LiberationSans-Regular.ttf",
     "FreeSans.ttf","Arial.ttf","Ubuntu-R.ttf","Cantarell-VF.otf","SFNS.ttf"
   };
   for(size_t i=0;i<sizeof(preferred)/sizeof(preferred[0]);++i)
-    if(try_candidates(out,preferred[i])) return out;
+    if(try_candidates(out,preferred[i])){ font_cache_store(out); return out; }
 
-  /* 3) Escaneo profundo como último recurso */
+  /* 4) Escaneo profundo como último recurso (paralelo, limitado en profundidad) */
+  char r0[PATH_MAX]={0}, r1[PATH_MAX]={0}, r2[PATH_MAX]={0};
 #if defined(_WIN32)
-  const char* roots[]={
-    "C:\\\\Windows\\\\Fonts",
-    getenv("LOCALAPPDATA")? getenv("LOCALAPPDATA") : ""
+  const char* local=getenv("LOCALAPPDATA");
+  if(local) snprintf(r0,sizeof(r0), "%s\\Microsoft\\Windows\\Fonts", local);
+  const char* roots[]={ "C:\\Windows\\Fonts", r0 };
+#else
+  const char* home=getenv("HOME");
+  if(home){
+    snprintf(r0,sizeof(r0), "%s/.local/share/fonts", home);
+    snprintf(r1,sizeof(r1), "%s/.fonts", home);
+# if defined(__APPLE__)
+    snprintf(r2,sizeof(r2), "%s/Library/Fonts", home);
+# endif
+  }
+  const char* roots[]={ "/usr/share/fonts", "/usr/local/share/fonts", r0, r1, r2,
+# if defined(__APPLE__)
+                        "/System/Library/Fonts", "/Library/Fonts"
+# endif
   };
-  for(size_t i=0;i<sizeof(roots)/sizeof(roots[0]);++i){
-    if(roots[i] && roots[i][0]){
-      char start[PATH_MAX];
-      if(i==1) snprintf(start,sizeof(start), "%s\\\\Microsoft\\\\Windows\\\\Fonts", roots[i]);
-      else snprintf(start,sizeof(start), "%s", roots[i]);
-      if(search_dir_win(start,out)) return out;
-    }
+#endif
+  (void)r1; (void)r2;
+  if(font_scan(roots,(int)(sizeof(roots)/sizeof(roots[0])),preferred,(int)(sizeof(preferred)/sizeof(preferred[0])),out)){ font_cache_store(out); return out; }
+  return NULL;
+}
+
+/* =================== MOVE JOURNAL =================== */
+/* The game in progress is autosaved to an append-only file in the pref dir: a checkpoint (the
+   whole board) when a game starts and every JOURNAL_CKPT_EVERY records, and one fixed-size record
+   per change in between, so a move costs one small write + fflush instead of a full snapshot.
+   Resume rebuilds the undo history from all records and the board from the last checkpoint plus
+   the records after it. Every record carries a CRC, so a torn tail (crash mid-write) is cut off.
+   Records with the J_LINK bit undo and redo together with the one before them (an edit plus
+   the peer notes it changed).
+   Record (little-endian): kind|J_LINK, v_old, v_new, strikes, cell|mistakes<<16, notes_old,
+   notes_new (checkpoint: payload size), elapsed ms, crc32. */
+#define JOURNAL_MAGIC "SKJ1"
+#define JREC 24
+#define JOURNAL_CKPT_EVERY 64
+enum { J_CKPT=1, J_MOVE=2, J_UNDO=3, J_REDO=4, J_STATS=5, J_LINK=0x80 };
+
+typedef struct { uint16_t cell; uint8_t v_old, v_new, link; uint32_t notes_old, notes_new; } JMove;
+typedef struct {
+  char path[PATH_MAX]; FILE* f;      /* empty path: no pref dir, autosave off */
+  JMove* mv; int n, cursor, cap;     /* undo history; mv[cursor..n) can be redone */
+  int since_ckpt, mistakes, strikes; /* stats as of the last record written */
+} Journal;
+
+static void jrec_make(unsigned char r[JREC],int kind,const JMove*m,const UI*ui){
+  memset(r,0,JREC); r[0]=(unsigned char)(kind | (m && m->link? J_LINK : 0));
+  r[3]=(unsigned char)(ui->strikes>255? 255 : ui->strikes);
+  wr32(r+4,(uint32_t)(m? m->cell : 0) | (uint32_t)(ui->mistakes>0xffff? 0xffff : ui->mistakes)<<16);
+  if(m){ r[1]=m->v_old; r[2]=m->v_new; wr32(r+8,m->notes_old); wr32(r+12,m->notes_new); }
+  double el=elapsed_time(ui); wr32(r+16,(uint32_t)(el>0? el*1000.0 : 0));
+  wr32(r+20,crc32_update(0,r,20));
+}
+static void journal_write(Journal*j,const void*p,size_t n){
+  if(!j->f) return;
+  if(fwrite(p,1,n,j->f)!=n || fflush(j->f)!=0){ fprintf(stderr,"journal: write failed, autosave off\n"); fclose(j->f); j->f=NULL; }
+}
+/* checkpoint payload: box, mode, strict, note flags, then puzzle/solution/fixed/notes per cell, crc32 */
+static void journal_checkpoint(Journal*j,const Game*g,const UI*ui){
+  int cells=g->side*g->side; size_t len=4+7*(size_t)cells;
+  unsigned char* b=(unsigned char*)malloc(JREC+len+4), *p=b+JREC; if(!b) return;
+  p[0]=(unsigned char)g->box; p[1]=(unsigned char)ui->mode; p[2]=ui->strict_mode;
+  p[3]=(unsigned char)(ui->notes_mode | ui->auto_notes<<1 | ui->auto_prune<<2);
+  for(int i=0;i<cells;i++){ unsigned char* c=p+4+7*i; c[0]=(unsigned char)g->puzzle[i]; c[1]=(unsigned char)g->solution[i]; c[2]=game_fixed(g,i); wr32(c+3,g->notes[i]); }
+  wr32(p+len,crc32_update(0,p,len));
+  jrec_make(b,J_CKPT,NULL,ui); wr32(b+12,(uint32_t)len); wr32(b+20,crc32_update(0,b,20));
+  journal_write(j,b,JREC+len+4); free(b);
+  j->since_ckpt=0; j->mistakes=ui->mistakes; j->strikes=ui->strikes;
+}
+static void journal_record(Journal*j,int kind,const JMove*m,const Game*g,const UI*ui){
+  unsigned char r[JREC]; jrec_make(r,kind,m,ui); journal_write(j,r,JREC);
+  j->mistakes=ui->mistakes; j->strikes=ui->strikes;
+  if(++j->since_ckpt>=JOURNAL_CKPT_EVERY) journal_checkpoint(j,g,ui);
+}
+static bool journal_push(Journal*j,JMove m){
+  if(j->cursor>=j->cap){
+    int cap=j->cap? j->cap*2 : 256; JMove* p=(JMove*)realloc(j->mv,(size_t)cap*sizeof *p);
+    if(!p) return false;
+    j->mv=p; j->cap=cap;
+  }
+  j->mv[j->cursor++]=m; j->n=j->cursor; return true;   /* a new move drops the redo tail */
+}
+
+/* a new game: start the file over with a checkpoint and forget the undo history */
+static void journal_begin(Journal*j,const Game*g,const UI*ui){
+  if(j->f) fclose(j->f);
+  j->f=NULL; j->n=j->cursor=0;
+  if(!j->path[0] || !(j->f=fopen(j->path,"wb"))) return;
+  journal_write(j,JOURNAL_MAGIC,4); journal_checkpoint(j,g,ui);
+}
+/* game over (or nothing worth resuming): the file goes away */
+static void journal_end(Journal*j){
+  if(j->f){ fclose(j->f); j->f=NULL; }
+  if(j->path[0]) remove(j->path);
+  j->n=j->cursor=0;
+}
+static void journal_close(Journal*j){ if(j->f) fclose(j->f); j->f=NULL; free(j->mv); j->mv=NULL; j->n=j->cursor=j->cap=0; }
+/* mistakes/strikes (and the clock) changed without a board edit; force also records the time */
+static void journal_stats(Journal*j,const Game*g,const UI*ui,bool force){
+  if(j->f && (force || ui->mistakes!=j->mistakes || ui->strikes!=j->strikes)) journal_record(j,J_STATS,NULL,g,ui);
+}
+/* cell i was edited (v_old/notes_old: its state before the edit); link joins it to the
+   previous record's undo step. Returns whether anything changed. */
+static bool journal_move(Journal*j,const Game*g,const UI*ui,int i,int v_old,uint32_t notes_old,bool link){
+  JMove m={(uint16_t)i,(uint8_t)v_old,(uint8_t)g->puzzle[i],(uint8_t)link,notes_old,g->notes[i]};
+  if(m.v_old==m.v_new && m.notes_old==m.notes_new) return false;
+  journal_push(j,m); journal_record(j,J_MOVE,&m,g,ui); return true;
+}
+/* undo/redo walk the history one step (a move and its linked records); mistakes already made stay counted */
+static bool journal_undo(Journal*j,Game*g,const UI*ui){
+  if(j->cursor==0) return false;
+  const JMove* m;
+  do{
+    m=&j->mv[--j->cursor];
+    game_set(g,m->cell,m->v_old); g->notes[m->cell]=m->notes_old;
+    journal_record(j,J_UNDO,m,g,ui);
+  }while(m->link && j->cursor>0);
+  return true;
+}
+static bool journal_redo(Journal*j,Game*g,const UI*ui){
+  if(j->cursor==j->n) return false;
+  do{
+    const JMove* m=&j->mv[j->cursor++];
+    game_set(g,m->cell,m->v_new); g->notes[m->cell]=m->notes_new;
+    journal_record(j,J_REDO,m,g,ui);
+  }while(j->cursor<j->n && j->mv[j->cursor].link);
+  return true;
+}
+
+/* every board edit made by the player goes through these so it lands in the journal */
+typedef struct { int n; int cell[3*MAX_SIDE]; uint32_t notes[3*MAX_SIDE]; } Peers;
+static void peers_save(const Game*g,int i,Peers*p){   /* the distinct row/col/box peers of i */
+  int n=g->side, b=g->box, r=i/n, c=i%n, br=(r/b)*b, bc=(c/b)*b; p->n=0;
+  for(int k=0;k<n;k++){
+    int row=r*n+k, col=k*n+c, box=(br+k/b)*n + bc+k%b;
+    if(k!=c) p->cell[p->n++]=row;
+    if(k!=r) p->cell[p->n++]=col;
+    if(box/n!=r && box%n!=c) p->cell[p->n++]=box;
   }
+  for(int k=0;k<p->n;k++) p->notes[k]=g->notes[p->cell[k]];
+}
+/* cell i changed from v0/n0: with auto-notes or auto-prune the peer notes follow, as one undo step */
+static void play_edited(Journal*j,Game*g,const UI*ui,int i,int v0,uint32_t n0,const Peers*p){
+  if(p) game_update_notes(g,i,v0,ui->auto_notes);
+  bool linked=journal_move(j,g,ui,i,v0,n0,false);
+  if(p) for(int k=0;k<p->n;k++) linked|=journal_move(j,g,ui,p->cell[k],g->puzzle[p->cell[k]],p->notes[k],linked);
+}
+static bool play_place(Journal*j,Game*g,const UI*ui,int r,int c,int v,bool strict){
+  int i=GIDX(g,r,c), v0=g->puzzle[i]; uint32_t n0=g->notes[i];
+  Peers p; bool follow=ui->auto_notes || ui->auto_prune; if(follow) peers_save(g,i,&p);
+  bool ok=place(g,r,c,v,strict); if(ok) play_edited(j,g,ui,i,v0,n0,follow? &p : NULL);
+  return ok;
+}
+static bool play_hint(Journal*j,Game*g,const UI*ui,int r,int c){
+  int i=GIDX(g,r,c), v0=g->puzzle[i]; uint32_t n0=g->notes[i];
+  Peers p; bool follow=ui->auto_notes || ui->auto_prune; if(follow) peers_save(g,i,&p);
+  bool ok=give_hint(g,r,c); if(ok) play_edited(j,g,ui,i,v0,n0,follow? &p : NULL);
+  return ok;
+}
+static void play_note(Journal*j,Game*g,const UI*ui,int i,int v){
+  if(game_fixed(g,i) || g->puzzle[i]) return;
+  uint32_t n0=g->notes[i]; g->notes[i]^=(1u<<v); journal_move(j,g,ui,i,0,n0,false);
+}
+/* auto-notes switched on: candidates everywhere, one undo step */
+static void play_fill_notes(Journal*j,Game*g,const UI*ui){
+  int cells=g->side*g->side; uint32_t old[MAX_CELLS]; memcpy(old,g->notes,(size_t)cells*sizeof old[0]);
+  game_fill_notes(g);
+  bool linked=false;
+  for(int i=0;i<cells;i++) linked|=journal_move(j,g,ui,i,g->puzzle[i],old[i],linked);
+}
+
+static bool journal_load_ckpt(const unsigned char*p,uint32_t len,Game*g,UI*ui){
+  int box=p[0], n=box*box, cells=n*n;
+  if(!valid_box(box) || p[1]>MODE_TIME || len!=4+7u*(uint32_t)cells) return false;
+  g->box=box; g->side=n; memset(g->fixed,0,sizeof g->fixed);
+  for(int i=0;i<cells;i++){
+    const unsigned char* c=p+4+7*i;
+    if(c[0]>n || c[1]<1 || c[1]>n) return false;
+    g->puzzle[i]=c[0]; g->solution[i]=c[1]; g->notes[i]=rd32(c+3);
+    if(c[2]) g->fixed[i>>6]|=1ull<<(i&63);
+  }
+  game_rebuild(g);
+  ui->mode=(Mode)p[1]; ui->strict_mode=p[2]!=0;
+  ui->notes_mode=(p[3]&1)!=0; ui->auto_notes=(p[3]&2)!=0; ui->auto_prune=(p[3]&4)!=0;
+  return true;
+}
+static bool file_truncate(FILE*f,long len){
+#if defined(_WIN32)
+  return _chsize(_fileno(f),len)==0;
 #else
-  const char* roots[]={"/usr/share/fonts","/usr/local/share/fonts",
-                       getenv("HOME")? getenv("HOME") : NULL,
-#if defined(__APPLE__)
-                       "/System/Library/Fonts","/Library/Fonts"
+  return ftruncate(fileno(f),(off_t)len)==0;
 #endif
-  };
-  for(size_t i=0;i<sizeof(roots)/sizeof(roots[0]);++i){
-    if(!roots[i]) continue;
-    char start[PATH_MAX];
-    if(roots[i]==getenv("HOME")){
-      snprintf(start,sizeof(start), "%s/.local/share/fonts", roots[i]);
-      if(search_dir_posix(start,out)) return out;
-      snprintf(start,sizeof(start), "%s/.fonts", roots[i]);
-      if(search_dir_posix(start,out)) return out;
-#if defined(__APPLE__)
-      snprintf(start,sizeof(start), "%s/Library/Fonts", roots[i]);
-      if(search_dir_posix(start,out)) return out;
-#endif
-    }else{
-      snprintf(start,sizeof(start), "%s", roots[i]);
-      if(search_dir_posix(start,out)) return out;
+}
+/* Reload an interrupted game into g/ui and go straight to the board. Returns false (and drops
+   the file) when there is nothing to resume: no journal, no valid checkpoint, or a finished game. */
+static bool journal_resume(Journal*j,Game*g,UI*ui){
+  if(!j->path[0]) return false;
+  FILE* f=fopen(j->path,"rb"); if(!f) return false;
+  unsigned char* b=NULL; long len=0;
+  if(fseek(f,0,SEEK_END)==0 && (len=ftell(f))>=4 && fseek(f,0,SEEK_SET)==0 && (b=(unsigned char*)malloc((size_t)len)) && fread(b,1,(size_t)len,f)!=(size_t)len){ free(b); b=NULL; }
+  fclose(f);
+  /* pass 1: the valid prefix and its last checkpoint */
+  long off=4, end=4, last=-1;
+  if(b && !memcmp(b,JOURNAL_MAGIC,4))
+    while(off+JREC<=len && (b[off]&~J_LINK)>=J_CKPT && (b[off]&~J_LINK)<=J_STATS && rd32(b+off+20)==crc32_update(0,b+off,20)){
+      long next=off+JREC;
+      if((b[off]&~J_LINK)==J_CKPT){
+        uint32_t plen=rd32(b+off+12);
+        if((long)plen>len-next-4 || rd32(b+next+plen)!=crc32_update(0,b+next,plen)) break;
+        last=off; next+=(long)plen+4;
+      }
+      off=end=next;
     }
+  /* pass 2: history from every record, board from the last checkpoint on */
+  bool ok=last>=0; uint32_t mistakes=0, ms=0; int strikes=0;   /* from the newest record */
+  j->n=j->cursor=0; j->since_ckpt=0;
+  for(off=4; ok && off<end; ){
+    const unsigned char* r=b+off; int kind=r[0]&~J_LINK;
+    JMove m={(uint16_t)(rd32(r+4)&0xffff),r[1],r[2],(uint8_t)(r[0]>>7),rd32(r+8),rd32(r+12)};
+    bool live=off>last; off+=JREC;
+    mistakes=rd32(r+4)>>16; strikes=r[3]; ms=rd32(r+16);
+    if(kind==J_CKPT){ if(off-JREC==last) ok=journal_load_ckpt(b+off,m.notes_new,g,ui); off+=(long)m.notes_new+4; continue; }
+    if(kind==J_MOVE) ok=journal_push(j,m);
+    else if(kind==J_UNDO){ if(j->cursor>0) j->cursor--; }
+    else if(kind==J_REDO){ if(j->cursor<j->n) j->cursor++; }
+    if(!live) continue;
+    j->since_ckpt++;
+    if(kind==J_STATS) continue;
+    int v = kind==J_UNDO? m.v_old : m.v_new; uint32_t notes = kind==J_UNDO? m.notes_old : m.notes_new;
+    if(m.cell>=g->side*g->side || v>g->side || game_fixed(g,m.cell)){ ok=false; break; }
+    game_set(g,m.cell,v); g->notes[m.cell]=notes;
   }
-#endif
-  return NULL;
+  free(b);
+  if(!ok || is_solved(g)){ journal_end(j); return false; }
+  ui->box=g->box; set_mode_params(ui);
+  ui->mistakes=(int)mistakes; ui->strikes=strikes;
+  ui->screen=SCR_PLAY; ui->paused=false; ui->paused_accum=0; ui->start_t=now_s()-ms*0.001;
+  j->mistakes=ui->mistakes; j->strikes=ui->strikes;
+  /* keep appending after the valid prefix; a torn tail is cut off first */
+  if((j->f=fopen(j->path,"r+b")) && (!file_truncate(j->f,end) || fseek(j->f,0,SEEK_END)!=0)){ fclose(j->f); j->f=NULL; }
+  return true;
 }
 
 /* =================== DRAW HELPERS =================== */
@@ -467,11 +1326,144 @@ static SDL_Texture* render_text_wrapped(Gfx*g, TTF_Font* f, const char* txt, SDL
   if(h) *h=s->h;
   SDL_FreeSurface(s); return t;
 }
+/* 1..9, then A, B, ... for the 16x16 and 25x25 boards */
+static void digit_label(int v,char out[2]){ out[0]=(char)(v<=9? '0'+v : 'A'+v-10); out[1]=0; }
+
+/* Glyph atlas: one texture, big glyphs on the first row and small ones on the second.
+   White glyphs + color/alpha mod, so a theme switch needs no rebuild; only a new font
+   or a lost device (SDL_RENDER_DEVICE_RESET) does. */
+#define ATLAS_PAD 2   /* transparent gap so linear filtering never bleeds a neighbour in */
+static void atlas_free(Gfx*g){ if(g->atlas.tex) SDL_DestroyTexture(g->atlas.tex); g->atlas.tex=NULL; }
+static bool atlas_build(Gfx*g){
+  atlas_free(g);
+  SDL_Surface* gl[2][MAX_SIDE+1]={{0}}; TTF_Font* f[2]={ g->font_big, g->font_small };
+  int W=0, row_h[2]={0,0}; bool ok=true;
+  for(int k=0;k<2 && ok;k++){
+    int x=ATLAS_PAD;
+    for(int v=1;v<=MAX_SIDE && ok;v++){
+      char b[2]; digit_label(v,b);
+      gl[k][v]=TTF_RenderUTF8_Blended(f[k],b,(SDL_Color){255,255,255,255});
+      if(!gl[k][v]){ ok=false; break; }
+      SDL_Rect* r = k? &g->atlas.small[v] : &g->atlas.big[v];
+      *r=(SDL_Rect){ x, 0, gl[k][v]->w, gl[k][v]->h }; x+=r->w+ATLAS_PAD;
+      if(r->h>row_h[k]) row_h[k]=r->h;
+    }
+    if(x>W) W=x;
+  }
+  g->atlas.w=W; g->atlas.h=row_h[0]+row_h[1]+3*ATLAS_PAD;
+  SDL_Surface* sheet = ok? SDL_CreateRGBSurfaceWithFormat(0,g->atlas.w,g->atlas.h,32,SDL_PIXELFORMAT_ARGB8888) : NULL;
+  for(int k=0;k<2;k++) for(int v=1;v<=MAX_SIDE;v++){
+    if(!gl[k][v]) continue;
+    SDL_Rect* r = k? &g->atlas.small[v] : &g->atlas.big[v];
+    r->y = k? row_h[0]+2*ATLAS_PAD : ATLAS_PAD;
+    if(sheet){ SDL_SetSurfaceBlendMode(gl[k][v],SDL_BLENDMODE_NONE); SDL_Rect d=*r; SDL_BlitSurface(gl[k][v],NULL,sheet,&d); }
+    SDL_FreeSurface(gl[k][v]);
+  }
+  if(sheet){ g->atlas.tex=SDL_CreateTextureFromSurface(g->ren,sheet); SDL_FreeSurface(sheet); }
+  if(g->atlas.tex) SDL_SetTextureBlendMode(g->atlas.tex,SDL_BLENDMODE_BLEND);
+  return g->atlas.tex!=NULL;
+}
+static SDL_Rect glyph_size(const Gfx*g,bool big,int v){ return big? g->atlas.big[v] : g->atlas.small[v]; }
+
+/* Primitive batcher: colored quads, axis-aligned lines and atlas glyphs are queued and sent
+   with one SDL_RenderGeometry call per texture run (vertex colors do the tinting). On SDL
+   older than 2.0.18, or if the renderer rejects geometry, the queue is replayed with
+   FillRect / RenderCopy. Flush before any immediate draw that must land on top. */
+static bool batch_reserve(Batch*b){
+  if(b->nq<b->cap) return true;
+  int cap=b->cap? 2*b->cap : 256;
+  SDL_Vertex* v=realloc(b->v,(size_t)cap*4*sizeof *v); if(!v) return false; b->v=v;
+  int* idx=realloc(b->idx,(size_t)cap*6*sizeof *idx); if(!idx) return false; b->idx=idx;
+  static const int quad[6]={0,1,2,0,2,3};
+  for(int q=b->cap;q<cap;q++) for(int k=0;k<6;k++) idx[q*6+k]=q*4+quad[k];
+  b->cap=cap; return true;
+}
+static void batch_flush(Gfx*g){
+  Batch* b=&g->batch; if(!b->nq) return;
+  bool done=false;
+#if SDL_VERSION_ATLEAST(2,0,18)
+  if(b->tex){ SDL_SetTextureColorMod(b->tex,255,255,255); SDL_SetTextureAlphaMod(b->tex,255); }
+  else SDL_SetRenderDrawBlendMode(g->ren,SDL_BLENDMODE_BLEND);
+  done = SDL_RenderGeometry(g->ren,b->tex,b->v,b->nq*4,b->idx,b->nq*6)==0;
+#endif
+  for(int q=0;q<b->nq && !done;q++){
+    const SDL_Vertex* v=&b->v[q*4];
+    SDL_Rect d={ (int)v[0].position.x, (int)v[0].position.y, (int)(v[2].position.x-v[0].position.x), (int)(v[2].position.y-v[0].position.y) };
+    if(!b->tex){ draw_rect(g->ren,d.x,d.y,d.w,d.h,v[0].color); continue; }
+    SDL_Rect src={ (int)(v[0].tex_coord.x*g->atlas.w+0.5f), (int)(v[0].tex_coord.y*g->atlas.h+0.5f),
+                   (int)((v[2].tex_coord.x-v[0].tex_coord.x)*g->atlas.w+0.5f), (int)((v[2].tex_coord.y-v[0].tex_coord.y)*g->atlas.h+0.5f) };
+    SDL_SetTextureColorMod(b->tex,v[0].color.r,v[0].color.g,v[0].color.b); SDL_SetTextureAlphaMod(b->tex,v[0].color.a);
+    SDL_RenderCopy(g->ren,b->tex,&src,&d);
+  }
+  b->nq=0;
+}
+static void batch_quad(Gfx*g,SDL_Texture*tex,SDL_FRect d,SDL_FRect uv,SDL_Color c){
+  Batch* b=&g->batch;
+  if(b->nq && b->tex!=tex) batch_flush(g);
+  if(!batch_reserve(b)){ batch_flush(g); if(!batch_reserve(b)) return; }
+  b->tex=tex;
+  SDL_Vertex* v=&b->v[4*b->nq++];
+  const float xs[4]={d.x,d.x+d.w,d.x+d.w,d.x}, ys[4]={d.y,d.y,d.y+d.h,d.y+d.h};
+  const float us[4]={uv.x,uv.x+uv.w,uv.x+uv.w,uv.x}, vs[4]={uv.y,uv.y,uv.y+uv.h,uv.y+uv.h};
+  for(int k=0;k<4;k++) v[k]=(SDL_Vertex){ {xs[k],ys[k]}, c, {us[k],vs[k]} };
+}
+static void batch_rect(Gfx*g,int x,int y,int w,int h,SDL_Color c){
+  batch_quad(g,NULL,(SDL_FRect){(float)x,(float)y,(float)w,(float)h},(SDL_FRect){0,0,0,0},c);
+}
+/* a 1px quad covering the same pixels as SDL_RenderDrawLine (both ends included) */
+static void batch_line(Gfx*g,int x1,int y1,int x2,int y2,SDL_Color c){
+  if(x1!=x2 && y1!=y2){ batch_flush(g); draw_line(g->ren,x1,y1,x2,y2,c); return; }
+  batch_rect(g, x1<x2?x1:x2, y1<y2?y1:y2, abs(x2-x1)+1, abs(y2-y1)+1, c);
+}
+static void batch_glyph(Gfx*g,bool big,int v,SDL_Color col,SDL_Rect d){
+  if(!g->atlas.tex) return;
+  SDL_Rect s=glyph_size(g,big,v); float aw=(float)g->atlas.w, ah=(float)g->atlas.h;
+  batch_quad(g,g->atlas.tex,(SDL_FRect){(float)d.x,(float)d.y,(float)d.w,(float)d.h},(SDL_FRect){s.x/aw,s.y/ah,s.w/aw,s.h/ah},col);
+}
+/* Layers: if(layer_begin(...)){ draw static part; layer_end(g); } layer_blit(...); then overlays.
+   Layers are opaque (cleared to the theme background), so they are copied without blending.
+   Without render-target support layer_begin always returns true and draws to the screen. */
+static LayerKey layer_key(const Gfx*g,bool dark,int mode,int box){
+  LayerKey k; memset(&k,0,sizeof k); k.w=g->width; k.h=g->height; k.dark=dark; k.mode=mode; k.box=box; return k;
+}
+static bool layer_begin(Gfx*g,LayerId id,LayerKey key){
+  Layer* L=&g->layer[id];
+  if(!g->targets){ prof_begin(&g->prof,PH_LAYER); return true; }
+  if(L->valid && !memcmp(&L->key,&key,sizeof key)) return false;
+  prof_begin(&g->prof,PH_LAYER);
+  if(L->tex && (L->w!=g->width || L->h!=g->height)){ SDL_DestroyTexture(L->tex); L->tex=NULL; }
+  if(!L->tex){
+    L->tex=SDL_CreateTexture(g->ren,SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_TARGET,g->width,g->height);
+    L->w=g->width; L->h=g->height;
+    if(L->tex) SDL_SetTextureBlendMode(L->tex,SDL_BLENDMODE_NONE);
+  }
+  L->valid = L->tex && SDL_SetRenderTarget(g->ren,L->tex)==0;   /* else: draw straight to the screen */
+  L->key=key; return true;
+}
+static void layer_end(Gfx*g){ if(g->targets) SDL_SetRenderTarget(g->ren,NULL); prof_end(&g->prof,PH_LAYER); }
+static void layer_blit(Gfx*g,LayerId id){ Layer* L=&g->layer[id]; if(g->targets && L->valid) SDL_RenderCopy(g->ren,L->tex,NULL,NULL); }
+static void layers_invalidate(Gfx*g){ for(int i=0;i<LAYER_COUNT;i++) g->layer[i].valid=false; }
+
+static SDL_Texture* cached_text(Gfx*g,TextId id,TTF_Font*f,const char*txt,SDL_Color col,int wrap,int*w,int*h){
+  TextSlot* t=&g->text[id];
+  if(!t->tex || t->font!=f || t->wrap!=wrap || memcmp(&t->col,&col,sizeof col) || strcmp(t->s,txt)){
+    if(t->tex) SDL_DestroyTexture(t->tex);
+    t->tex = wrap>0? render_text_wrapped(g,f,txt,col,wrap,&t->w,&t->h) : render_text(g,f,txt,col,&t->w,&t->h);
+    t->font=f; t->wrap=wrap; t->col=col; snprintf(t->s,sizeof t->s,"%s",txt);
+  }
+  *w=t->w; *h=t->h; return t->tex;
+}
+/* textures die with the device (SDL_RENDER_DEVICE_RESET) and at exit */
+static void gfx_drop_caches(Gfx*g){
+  for(int i=0;i<LAYER_COUNT;i++){ if(g->layer[i].tex) SDL_DestroyTexture(g->layer[i].tex); g->layer[i].tex=NULL; g->layer[i].valid=false; }
+  for(int i=0;i<TXT_COUNT;i++){ if(g->text[i].tex) SDL_DestroyTexture(g->text[i].tex); g->text[i].tex=NULL; }
+}
 static bool point_in(SDL_Rect r,int x,int y){ return x>=r.x && x<r.x+r.w && y>=r.y && y<r.y+r.h; }
 
 /* Responsive layout */
 typedef struct { SDL_Rect board; SDL_Rect side; bool right; } Layout;
-static Layout compute_layout(int W,int H){
+/* n = cells per side; the board is rounded to a whole number of cells */
+static Layout compute_layout(int W,int H,int n){
   Layout L; int margin=18; int gap=16; int minCell=28; int minSide = 9*minCell;
 
   if(W >= 980){
@@ -480,7 +1472,7 @@ static Layout compute_layout(int W,int H){
     int usableW = W - 2*margin - sidebarW - gap;
     if(side > usableW) side = usableW;
     if(side < minSide) side=minSide;
-    side = (side/9)*9;
+    side = (side/n)*n;
     L.board = (SDL_Rect){ margin, (H - side)/2, side, side };
     L.side  = (SDL_Rect){ L.board.x + L.board.w + gap, L.board.y, sidebarW, side };
     L.right = true;
@@ -489,7 +1481,7 @@ static Layout compute_layout(int W,int H){
     if(side < minSide) side = minSide;
     if(side > H - (margin*3 + 280)) side = H - (margin*3 + 280);
     if(side < minSide) side = minSide;
-    side = (side/9)*9;
+    side = (side/n)*n;
     L.board = (SDL_Rect){ (W - side)/2, margin, side, side };
     L.side  = (SDL_Rect){ margin, L.board.y + L.board.h + gap, W - 2*margin, 260 };
     L.right = false;
@@ -500,13 +1492,13 @@ static Layout compute_layout(int W,int H){
 /* ===== Sidebar geometry: ONE source of truth for render + clicks ===== */
 typedef struct {
   SDL_Rect btn[9];   /* New, Mode, Hint, Notes, Verify, Theme, Help, About, Menu */
-  SDL_Rect pal[9];   /* numbers 1..9 */
+  SDL_Rect pal[MAX_SIDE];   /* numbers 1..side: one column up to 9x9, a box-wide grid above */
   int count_btn;
   int count_pal;
   int title_h, info_h, info_lines;
 } SidebarRects;
 
-static void compute_sidebar_rects(const Layout*L, const UI*ui, SidebarRects*R){
+static void compute_sidebar_rects(const Layout*L, const UI*ui, const Game*game, SidebarRects*R){
   const int sx=L->side.x, sy=L->side.y, sw=L->side.w;
   const int title_h=46, info_h=24, gap_small=4, gap_big=8;
   int info_lines = 2; /* Mode + Time */
@@ -519,9 +1511,10 @@ static void compute_sidebar_rects(const Layout*L, const UI*ui, SidebarRects*R){
 
   for(int i=0;i<9;i++){ R->btn[i] = (SDL_Rect){sx, y, bw, bh}; y += bh + gap_big; }
   y += 4 + info_h; /* "Palette" label + gap */
-  for(int n=0;n<9;n++){ R->pal[n] = (SDL_Rect){sx, y, bw, bh}; y += bh + 6; }
+  int cols = game->side<=9? 1 : game->box, pw=(bw-(cols-1)*6)/cols;
+  for(int n=0;n<game->side;n++) R->pal[n] = (SDL_Rect){sx + (n%cols)*(pw+6), y + (n/cols)*(bh+6), pw, bh};
 
-  R->count_btn=9; R->count_pal=9; R->title_h=title_h; R->info_h=info_h; R->info_lines=info_lines;
+  R->count_btn=9; R->count_pal=game->side; R->title_h=title_h; R->info_h=info_h; R->info_lines=info_lines;
 }
 
 /* Back button geometry + draw */
@@ -536,162 +1529,179 @@ static void draw_back_button(Gfx*g, Theme th){
   if(t){ SDL_Rect d={r.x+12,r.y+(r.h-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
 }
 
+/* F3 overlay: summary text refreshed 4x a second (re-rasterized only then) */
+static void render_prof_hud(Gfx*g){
+  Prof* p=&g->prof; double t=now_s();
+  if(!p->hud_text[0] || t-p->hud_t>=0.25){ prof_summary(p,p->hud_text,sizeof p->hud_text); p->hud_t=t; }
+  int tw,thh; SDL_Texture* tx=cached_text(g,TXT_HUD,g->font_small,p->hud_text,(SDL_Color){230,230,230,255},g->width-40,&tw,&thh);
+  if(tx){ draw_rect(g->ren,10,10,tw+20,thh+16,(SDL_Color){0,0,0,170}); SDL_Rect d={20,18,tw,thh}; SDL_RenderCopy(g->ren,tx,NULL,&d); }
+}
+
 /* =================== RENDER SCREENS =================== */
+/* centered in (x,y,w,h); glyphs taller than max_h are scaled down to fit small cells */
+static SDL_Rect fit_rect(int x,int y,int w,int h,int tw,int th,int max_h){
+  if(th>max_h && th>0){ tw=tw*max_h/th; th=max_h; }
+  SDL_Rect d={ x+(w-tw)/2, y+(h-th)/2, tw, th }; return d;
+}
+
 static void render_board_and_sidebar(Gfx*g,const Game*game, UI*ui){
   Theme th = ui->dark_theme ? theme_dark() : theme_light();
-  SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255);
-  SDL_RenderClear(g->ren);
-
-  Layout L = compute_layout(g->width,g->height);
-  int gx=L.board.x, gy=L.board.y, side=L.board.w, cs=side/9;
+  const int n=game->side, bx=game->box;
+  Layout L = compute_layout(g->width,g->height,n);
+  int gx=L.board.x, gy=L.board.y, side=L.board.w, cs=side/n;
+  SidebarRects R; compute_sidebar_rects(&L, ui, game, &R);
+  int sx=L.side.x, sy=L.side.y, sw=L.side.w;
+  int tw,thh;
+  char buf[96];
+
+  /* static layer: background, board + grid, sidebar title, mode line, buttons, palette */
+  if(layer_begin(g,LAYER_PLAY,layer_key(g,ui->dark_theme,ui->mode,bx))){
+    SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255);
+    SDL_RenderClear(g->ren);
+    batch_rect(g, gx-6, gy-6, side+12, side+12, th.shadow);
+    batch_rect(g, gx, gy, side, side, th.board);
+    for(int i=0;i<=n;i++){
+      int x = gx + (side*i)/n;
+      int y = gy + (side*i)/n;
+      SDL_Color col = (i%bx==0)?th.thick:th.thin;
+      batch_line(g, x, gy, x, gy+side, col);
+      batch_line(g, gx, y, gx+side, y, col);
+    }
+    for(int i=0;i<R.count_btn;i++) batch_rect(g,R.btn[i].x,R.btn[i].y,R.btn[i].w,R.btn[i].h,th.btn);
+    for(int v=1;v<=R.count_pal;v++) batch_rect(g,R.pal[v-1].x,R.pal[v-1].y,R.pal[v-1].w,R.pal[v-1].h,th.palette_bg);
+    batch_flush(g);
+
+    SDL_Texture* tt=render_text(g,g->font_big,"Sudokura v1.0", th.title,&tw,&thh);
+    if(tt){ SDL_Rect d={sx,sy,tw,thh}; SDL_RenderCopy(g->ren,tt,NULL,&d); SDL_DestroyTexture(tt); }
+
+    const char* modeName=(ui->mode==MODE_CLASSIC?"Classic": ui->mode==MODE_STRIKES?"Strikes":"Time Attack");
+    snprintf(buf,sizeof(buf),"Mode: %s   %dx%d", modeName, n, n);
+    SDL_Texture* t1=render_text(g,g->font_small,buf, th.dim,&tw,&thh);
+    if(t1){ SDL_Rect d={sx, sy + R.title_h + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t1,NULL,&d); SDL_DestroyTexture(t1); }
+
+    const char* labels[]={"New","Mode","Hint","Notes (N/Shift)","Verify","Theme","Help","About","Menu"};
+    for(int i=0;i<R.count_btn;i++){
+      SDL_Rect rc=R.btn[i];
+      SDL_Texture* t=render_text(g,g->font_small,labels[i], th.btnfg,&tw,&thh);
+      if(t){ SDL_Rect d={rc.x+10,rc.y+(rc.h-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
+    }
 
-  /* board bg + shadow */
-  draw_rect(g->ren, gx-6, gy-6, side+12, side+12, th.shadow);
-  draw_rect(g->ren, gx, gy, side, side, th.board);
+    SDL_Texture* tp=render_text(g,g->font_small,"Palette", th.dim, &tw,&thh);
+    if(tp){ SDL_Rect d={sx, R.pal[0].y - (thh+6), tw, thh}; SDL_RenderCopy(g->ren,tp,NULL,&d); SDL_DestroyTexture(tp); }
+    for(int v=1;v<=R.count_pal;v++){
+      SDL_Rect rc=R.pal[v-1], gs=glyph_size(g,false,v);
+      batch_glyph(g,false,v,th.palette_fg,(SDL_Rect){rc.x+12,rc.y+(rc.h-gs.h)/2,gs.w,gs.h});
+    }
+    batch_flush(g);
+    layer_end(g);
+  }
+  layer_blit(g,LAYER_PLAY);
 
   /* selection helpers */
-  draw_rect(g->ren, gx, gy + ui->sel_r*cs, side, cs, th.boxhl);
-  draw_rect(g->ren, gx + ui->sel_c*cs, gy, cs, side, th.boxhl);
-  int br=(ui->sel_r/3)*3, bc=(ui->sel_c/3)*3;
-  draw_rect(g->ren, gx + bc*cs, gy + br*cs, cs*3, cs*3, (SDL_Color){th.boxhl.r,th.boxhl.g,th.boxhl.b,(Uint8)(th.boxhl.a/2)});
-
-  /* grid */
-  for(int i=0;i<=9;i++){
-    int x = gx + (side*i)/9;
-    int y = gy + (side*i)/9;
-    SDL_Color col = (i%3==0)?th.thick:th.thin;
-    draw_line(g->ren, x, gy, x, gy+side, col);
-    draw_line(g->ren, gx, y, gx+side, y, col);
-  }
+  prof_begin(&g->prof,PH_BOARD);
+  batch_rect(g, gx, gy + ui->sel_r*cs, side, cs, th.boxhl);
+  batch_rect(g, gx + ui->sel_c*cs, gy, cs, side, th.boxhl);
+  int br=(ui->sel_r/bx)*bx, bc=(ui->sel_c/bx)*bx;
+  batch_rect(g, gx + bc*cs, gy + br*cs, cs*bx, cs*bx, (SDL_Color){th.boxhl.r,th.boxhl.g,th.boxhl.b,(Uint8)(th.boxhl.a/2)});
 
   /* cells + notes */
   int mx,my; SDL_GetMouseState(&mx,&my);
-  int curV = game->puzzle[IDX(ui->sel_r,ui->sel_c)];
-  for(int r=0;r<9;r++) for(int c=0;c<9;c++){
-    int x=gx+c*cs, y=gy+r*cs;
+  int curV = game->puzzle[GIDX(game,ui->sel_r,ui->sel_c)];
+  for(int r=0;r<n;r++) for(int c=0;c<n;c++){
+    int x=gx+c*cs, y=gy+r*cs, i=GIDX(game,r,c);
     bool sel = (ui->sel_r==r && ui->sel_c==c);
     bool hover = (mx>=x && mx<x+cs && my>=y && my<y+cs);
-    int v = game->puzzle[IDX(r,c)];
+    int v = game->puzzle[i];
 
-    if(curV && v==curV && !sel) draw_rect(g->ren, x+2,y+2, cs-4,cs-4, th.samehl);
+    if(curV && v==curV && !sel) batch_rect(g, x+2,y+2, cs-4,cs-4, th.samehl);
     if(sel){
       double t = now_s(); double p = 0.65 + 0.35*(0.5*(1.0+sin(t*4.0)));
-      draw_rect(g->ren, x+2,y+2, cs-4,cs-4, (SDL_Color){(Uint8)(th.sel.r*p),(Uint8)(th.sel.g*p),(Uint8)(th.sel.b*p),190});
+      batch_rect(g, x+2,y+2, cs-4,cs-4, (SDL_Color){(Uint8)(th.sel.r*p),(Uint8)(th.sel.g*p),(Uint8)(th.sel.b*p),190});
       SDL_Color o=th.sel_outline;
-      draw_line(g->ren, x+1,y+1, x+cs-2,y+1, o);
-      draw_line(g->ren, x+cs-2,y+1, x+cs-2,y+cs-2, o);
-      draw_line(g->ren, x+cs-2,y+cs-2, x+1,y+cs-2, o);
-      draw_line(g->ren, x+1,y+cs-2, x+1,y+1, o);
+      batch_line(g, x+1,y+1, x+cs-2,y+1, o);
+      batch_line(g, x+cs-2,y+1, x+cs-2,y+cs-2, o);
+      batch_line(g, x+cs-2,y+cs-2, x+1,y+cs-2, o);
+      batch_line(g, x+1,y+cs-2, x+1,y+1, o);
     } else if(hover){
-      draw_rect(g->ren, x+2,y+2, cs-4,cs-4, th.hover);
+      batch_rect(g, x+2,y+2, cs-4,cs-4, th.hover);
     }
 
-    if(v && has_conflict(game,r,c,v)) draw_rect(g->ren, x+2,y+2, cs-4,cs-4, th.conflict);
+    if(cell_in_conflict(game,i)) batch_rect(g, x+2,y+2, cs-4,cs-4, th.conflict);
 
     if(sel || ui->notes_mode){
       SDL_Color sgrid=(SDL_Color){th.thin.r,th.thin.g,th.thin.b, (Uint8)120};
-      int sub=cs/3; for(int k=1;k<3;k++){
-        draw_line(g->ren,x+k*sub,y+2,x+k*sub,y+cs-2,sgrid);
-        draw_line(g->ren,x+2,y+k*sub,x+cs-2,y+k*sub,sgrid);
+      int sub=cs/bx; for(int k=1;k<bx;k++){
+        batch_line(g,x+k*sub,y+2,x+k*sub,y+cs-2,sgrid);
+        batch_line(g,x+2,y+k*sub,x+cs-2,y+k*sub,sgrid);
       }
     }
+  }
 
+  batch_flush(g);
+  prof_end(&g->prof,PH_BOARD);
+
+  /* digits and notes in a second pass, so overlays and glyphs each go out as one batch */
+  prof_begin(&g->prof,PH_NOTES);
+  for(int r=0;r<n;r++) for(int c=0;c<n;c++){
+    int x=gx+c*cs, y=gy+r*cs, i=GIDX(game,r,c), v=game->puzzle[i];
     if(v){
-      SDL_Color col = game->fixed[IDX(r,c)]?th.text_given:th.text_edit;
-      if(!game->fixed[IDX(r,c)] && v!=game->solution[IDX(r,c)]) col=th.text_wrong;
-      char buf[2]={(char)('0'+v),0};
-      int tw,thh; SDL_Texture*t=render_text(g,g->font_big,buf,col,&tw,&thh);
-      if(t){ SDL_Rect d={ x + (cs-tw)/2, y + (cs-thh)/2, tw, thh }; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
-    }else if(game->notes[IDX(r,c)]){
-      for(int vv=1;vv<=9;vv++) if(game->notes[IDX(r,c)]&(1u<<vv)){
-        char b[2]={(char)('0'+vv),0}; SDL_Color ncol=th.dim; int tw,thh;
-        SDL_Texture*t=render_text(g,g->font_small,b,ncol,&tw,&thh);
-        if(t){
-          int sub=cs/3; int q=(vv-1)/3, qq=(vv-1)%3;
-          int nx = x + qq*sub + (sub-tw)/2;
-          int ny = y + q*sub  + (sub-thh)/2;
-          SDL_Rect d={nx,ny,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t);
-        }
+      SDL_Color col = game_fixed(game,i)?th.text_given:th.text_edit;
+      if(!game_fixed(game,i) && v!=game->solution[i]) col=th.text_wrong;
+      SDL_Rect gs=glyph_size(g,true,v);
+      batch_glyph(g,true,v,col,fit_rect(x,y,cs,cs,gs.w,gs.h,cs*4/5));
+    }else if(game->notes[i]){
+      int sub=cs/bx;
+      for(int vv=1;vv<=n;vv++) if(game->notes[i]&(1u<<vv)){
+        SDL_Rect gs=glyph_size(g,false,vv); int q=(vv-1)/bx, qq=(vv-1)%bx;
+        batch_glyph(g,false,vv,th.dim,fit_rect(x+qq*sub,y+q*sub,sub,sub,gs.w,gs.h,sub));
       }
     }
   }
+  batch_flush(g);
+  prof_end(&g->prof,PH_NOTES);
 
-  /* sidebar text + buttons (using shared geometry) */
-  SidebarRects R; compute_sidebar_rects(&L, ui, &R);
-
-  int sx=L.side.x, sy=L.side.y, sw=L.side.w;
-  int tw,thh;
-
-  /* Title */
-  SDL_Texture* tt=render_text(g,g->font_big,"Sudokura v1.0", th.title,&tw,&thh);
-  if(tt){ SDL_Rect d={sx,sy,tw,thh}; SDL_RenderCopy(g->ren,tt,NULL,&d); SDL_DestroyTexture(tt); }
-
-  /* HUD lines (fixed spacing to match compute_sidebar_rects) */
-  const int line_y0 = sy + R.title_h + 0;
-  int y=line_y0;
-  char buf[64];
-  const char* modeName=(ui->mode==MODE_CLASSIC?"Classic": ui->mode==MODE_STRIKES?"Strikes":"Time Attack");
-  snprintf(buf,sizeof(buf),"Mode: %s", modeName);
-  SDL_Texture* t1=render_text(g,g->font_small,buf, th.dim,&tw,&thh);
-  if(t1){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t1,NULL,&d); SDL_DestroyTexture(t1); }
-  y += R.info_h + 4;
-
+  /* HUD lines below the mode line (fixed spacing to match compute_sidebar_rects) */
+  prof_begin(&g->prof,PH_SIDEBAR);
+  int y = sy + R.title_h + R.info_h + 4;
   double el=elapsed_time(ui);
   snprintf(buf,sizeof(buf),"Time: %02d:%02d", (int)(el/60),(int)fmod(el,60));
-  SDL_Texture* t2=render_text(g,g->font_small,buf, th.dim,&tw,&thh);
-  if(t2){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t2,NULL,&d); SDL_DestroyTexture(t2); }
+  SDL_Texture* t2=cached_text(g,TXT_TIME,g->font_small,buf, th.dim,0,&tw,&thh);
+  if(t2){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t2,NULL,&d); }
   y += R.info_h + 4;
 
   if(ui->mode==MODE_TIME){
     int rem=(int)(ui->time_limit_s-el); if(rem<0) rem=0;
     snprintf(buf,sizeof(buf),"Target: %02d:%02d", rem/60,rem%60);
-    SDL_Texture* t=render_text(g,g->font_small,buf, th.dim,&tw,&thh);
-    if(t){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
-    y += R.info_h + 4;
-  }
-  if(ui->mode==MODE_STRIKES){
+  }else if(ui->mode==MODE_STRIKES){
     int left=ui->strikes_max-ui->strikes; if(left<0) left=0;
     snprintf(buf,sizeof(buf),"Strikes left: %d/%d", left, ui->strikes_max);
-    SDL_Texture* t=render_text(g,g->font_small,buf, th.dim,&tw,&thh);
-    if(t){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
-  }
-
-  /* Buttons */
-  const char* labels[]={"New","Mode","Hint","Notes (N/Shift)","Verify","Theme","Help","About","Menu"};
-  for(int i=0;i<R.count_btn;i++){
-    SDL_Rect rc=R.btn[i];
-    draw_rect(g->ren,rc.x,rc.y,rc.w,rc.h,th.btn);
-    SDL_Texture* t=render_text(g,g->font_small,labels[i], th.btnfg,&tw,&thh);
-    if(t){ SDL_Rect d={rc.x+10,rc.y+(rc.h-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
   }
-
-  /* Palette */
-  SDL_Texture* tp=render_text(g,g->font_small,"Palette", th.dim, &tw,&thh);
-  if(tp){ SDL_Rect d={sx, R.pal[0].y - (thh+6), tw, thh}; SDL_RenderCopy(g->ren,tp,NULL,&d); SDL_DestroyTexture(tp); }
-  for(int n=1;n<=9;n++){
-    SDL_Rect rc=R.pal[n-1];
-    draw_rect(g->ren,rc.x,rc.y,rc.w,rc.h,th.palette_bg);
-    char nb[2]={(char)('0'+n),0}; SDL_Texture* t=render_text(g,g->font_small,nb, th.palette_fg,&tw,&thh);
-    if(t){ SDL_Rect d={rc.x+12,rc.y+(rc.h-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
+  if(ui->mode!=MODE_CLASSIC){
+    SDL_Texture* t=cached_text(g,TXT_LIMIT,g->font_small,buf, th.dim,0,&tw,&thh);
+    if(t){ SDL_Rect d={sx, y + (R.info_h-thh)/2, tw, thh}; SDL_RenderCopy(g->ren,t,NULL,&d); }
   }
 
   /* bottom info */
-  int filled=0; for(int i=0;i<81;i++) if(game->puzzle[i]) filled++;
-  snprintf(buf,sizeof(buf),"Progress %d%%   Errors %d", (filled*100)/81, ui->mistakes);
-  SDL_Texture* ts=render_text_wrapped(g,g->font_small, buf, th.dim, sw, &tw,&thh);
-  if(ts){ SDL_Rect d={sx, R.pal[8].y + R.pal[8].h + 6, tw, thh}; SDL_RenderCopy(g->ren,ts,NULL,&d); SDL_DestroyTexture(ts); }
+  int filled=0, cells=n*n; for(int i=0;i<cells;i++) if(game->puzzle[i]) filled++;
+  snprintf(buf,sizeof(buf),"Progress %d%%   Errors %d", (filled*100)/cells, ui->mistakes);
+  SDL_Texture* ts=cached_text(g,TXT_PROGRESS,g->font_small, buf, th.dim, sw, &tw,&thh);
+  const SDL_Rect* lastp=&R.pal[R.count_pal-1];
+  if(ts){ SDL_Rect d={sx, lastp->y + lastp->h + 6, tw, thh}; SDL_RenderCopy(g->ren,ts,NULL,&d); }
+  prof_end(&g->prof,PH_SIDEBAR);
 
   /* toast */
   if(ui->toast_on){
+    prof_begin(&g->prof,PH_TOAST);
     double dt=now_s()-ui->toast_t0; if(dt>2.2) ui->toast_on=false;
     if(ui->toast_on){
-      SDL_Texture* tt2=render_text(g,g->font_small,ui->toast,(SDL_Color){255,255,255,230},&tw,&thh);
-      if(tt2){ SDL_Rect d={ gx + (side-tw)/2, gy- (thh+8), tw, thh }; draw_rect(g->ren,d.x-8,d.y-6,tw+16,thh+12,(SDL_Color){0,0,0,110}); SDL_RenderCopy(g->ren,tt2,NULL,&d); SDL_DestroyTexture(tt2); }
+      SDL_Texture* tt2=cached_text(g,TXT_TOAST,g->font_small,ui->toast,(SDL_Color){255,255,255,230},0,&tw,&thh);
+      if(tt2){ SDL_Rect d={ gx + (side-tw)/2, gy- (thh+8), tw, thh }; draw_rect(g->ren,d.x-8,d.y-6,tw+16,thh+12,(SDL_Color){0,0,0,110}); SDL_RenderCopy(g->ren,tt2,NULL,&d); }
     }
+    prof_end(&g->prof,PH_TOAST);
   }
 }
 
-static void render_title(Gfx*g, UI*ui){
+static void render_title_layer(Gfx*g, UI*ui){
   Theme th = ui->dark_theme ? theme_dark() : theme_light();
   SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255);
   SDL_RenderClear(g->ren);
@@ -701,6 +1711,7 @@ static void render_title(Gfx*g, UI*ui){
 
   int bx=g->width/2-180, by=g->height/2-60, bw=360, bh=42, gap=12;
   SDL_Rect r_mode={bx,by,bw,bh}; by+=bh+gap;
+  SDL_Rect r_size={bx,by,bw,bh}; by+=bh+gap;
   SDL_Rect r_start={bx,by,bw,bh}; by+=bh+gap;
   SDL_Rect r_help={bx,by,bw,bh}; by+=bh+gap;
   SDL_Rect r_about={bx,by,bw,bh}; by+=bh+gap;
@@ -712,6 +1723,11 @@ static void render_title(Gfx*g, UI*ui){
   SDL_Texture* m1=render_text(g,g->font_small,mline, th.btnfg,&tw,&thh);
   if(m1){ SDL_Rect d={r_mode.x+12,r_mode.y+(bh-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,m1,NULL,&d); SDL_DestroyTexture(m1); }
 
+  draw_rect(g->ren,r_size.x,r_size.y,bw,bh,th.btn);
+  snprintf(mline,sizeof(mline),"Size: %dx%d (Z)", ui->box*ui->box, ui->box*ui->box);
+  SDL_Texture* z1=render_text(g,g->font_small,mline, th.btnfg,&tw,&thh);
+  if(z1){ SDL_Rect d={r_size.x+12,r_size.y+(bh-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,z1,NULL,&d); SDL_DestroyTexture(z1); }
+
   draw_rect(g->ren,r_start.x,r_start.y,bw,bh,(SDL_Color){(Uint8)(th.btn.r+10),(Uint8)(th.btn.g+10),(Uint8)(th.btn.b+10),th.btn.a});
   SDL_Texture* s=render_text(g,g->font_small,"Start", th.btnfg,&tw,&thh); if(s){ SDL_Rect d={r_start.x+12,r_start.y+(bh-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,s,NULL,&d); SDL_DestroyTexture(s); }
 
@@ -725,23 +1741,38 @@ static void render_title(Gfx*g, UI*ui){
   SDL_Texture* q=render_text(g,g->font_small,"Quit", th.btnfg,&tw,&thh); if(q){ SDL_Rect d={r_quit.x+12,r_quit.y+(bh-thh)/2,tw,thh}; SDL_RenderCopy(g->ren,q,NULL,&d); SDL_DestroyTexture(q); }
 }
 
+static void render_title(Gfx*g, UI*ui){
+  if(layer_begin(g,LAYER_TITLE,layer_key(g,ui->dark_theme,ui->mode,ui->box))){ render_title_layer(g,ui); layer_end(g); }
+  layer_blit(g,LAYER_TITLE);
+}
+/* drawn over any screen while ui->starting */
+static void render_generating(Gfx*g, UI*ui){
+  Theme th = ui->dark_theme ? theme_dark() : theme_light();
+  int tw,thh; SDL_Texture* t=render_text(g,g->font_small,"Generating puzzle...", th.dim,&tw,&thh);
+  if(t){ SDL_Rect d={(g->width-tw)/2, g->height-thh-24, tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
+}
+
 static void blit_wrapped(Gfx*g,int x,int y,int w,const char*text, SDL_Color col){
   int tw,thh; SDL_Texture* t=render_text_wrapped(g,g->font_small,text,col,w,&tw,&thh);
   if(t){ SDL_Rect d={x,y,tw,thh}; SDL_RenderCopy(g->ren,t,NULL,&d); SDL_DestroyTexture(t); }
 }
-static void render_help(Gfx*g, UI*ui){
+static void render_help_layer(Gfx*g, UI*ui){
   Theme th = ui->dark_theme?theme_dark():theme_light();
   SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255); SDL_RenderClear(g->ren);
   int tw,thh; SDL_Texture* T=render_text(g,g->font_big,"Help", th.title,&tw,&thh);
   if(T){ SDL_Rect d={60,40,tw,thh}; SDL_RenderCopy(g->ren,T,NULL,&d); SDL_DestroyTexture(T); }
   int x=60, y=40+thh+12, w=g->width-120;
   const char* text =
-    "- Goal: fill the 9x9 grid so each row, column and 3x3 box contains 1..9 with no repeats.\n"
+    "- Goal: fill the grid so each row, column and box contains every symbol once (9x9: 1..9 in 3x3 boxes).\n"
+    "- Sizes (Z on the menu): 4x4, 9x9, 16x16 (1..9, A..G) and 25x25 (1..9, A..P). Type 10+ with Ctrl+letter or the palette.\n"
     "- Modes: Classic (no limits). Strikes (3 wrong moves = lose). Time Attack (solve under 10:00).\n"
     "- Select a cell with mouse or arrows (WASD). Place with keys 1..9 or the palette.\n"
     "- Notes: press N to toggle Notes mode or hold Shift while typing numbers.\n"
     "         You can also note with the mouse: click a sub-cell (the 3x3 mini-grid inside the cell).\n"
+    "- Auto-notes (C): fills every empty cell with its legal candidates and keeps them updated as you play.\n"
+    "  Auto-prune (X): only removes a placed digit from the notes of its row, column and box.\n"
     "- Hint: fills the selected cell with the correct answer.\n"
+    "- Undo / Redo: Ctrl+Z / Ctrl+Y (or Ctrl+Shift+Z). The game is autosaved and resumed on the next launch.\n"
     "- Verify: checks conflicts against Sudoku rules (rows/cols/boxes). It does not reveal the solution.\n"
     "- Strict mode (M): blocks illegal placements. Free mode allows them (they still count as mistakes).\n"
     "- Theme (T) toggles dark/light. Pause (P) pauses the timer. ESC or Back returns.";
@@ -749,7 +1780,7 @@ static void render_help(Gfx*g, UI*ui){
   draw_back_button(g, th);
 }
 
-static void render_about(Gfx*g, UI*ui){
+static void render_about_layer(Gfx*g, UI*ui){
   Theme th = ui->dark_theme?theme_dark():theme_light();
   SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255); SDL_RenderClear(g->ren);
   int tw,thh; SDL_Texture* T=render_text(g,g->font_big,"About", th.title,&tw,&thh);
@@ -765,6 +1796,16 @@ static void render_about(Gfx*g, UI*ui){
   draw_back_button(g, th);
 }
 
+/* Help and About are fully static: wrapped text is laid out once per size/theme */
+static void render_help(Gfx*g, UI*ui){
+  if(layer_begin(g,LAYER_HELP,layer_key(g,ui->dark_theme,0,0))){ render_help_layer(g,ui); layer_end(g); }
+  layer_blit(g,LAYER_HELP);
+}
+static void render_about(Gfx*g, UI*ui){
+  if(layer_begin(g,LAYER_ABOUT,layer_key(g,ui->dark_theme,0,0))){ render_about_layer(g,ui); layer_end(g); }
+  layer_blit(g,LAYER_ABOUT);
+}
+
 static void render_end(Gfx*g, UI*ui){
   Theme th = ui->dark_theme?theme_dark():theme_light();
   SDL_SetRenderDrawColor(g->ren, th.bg.r,th.bg.g,th.bg.b,255); SDL_RenderClear(g->ren);
@@ -802,10 +1843,73 @@ static bool confirm_box(SDL_Window* win, const char* title, const char* msg, con
 }
 
 /* =================== MAIN =================== */
+/* "--opt=value" or "--opt value"; NULL if argv[*i] is not opt */
+static const char* arg_value(const char*opt,int argc,char**argv,int*i){
+  size_t n=strlen(opt);
+  if(strncmp(argv[*i],opt,n)) return NULL;
+  if(argv[*i][n]=='=') return argv[*i]+n+1;
+  if(argv[*i][n]==0) return (*i+1<argc)? argv[++*i] : "";
+  return NULL;
+}
+
+/* a fresh game on the board: reset the clock and counters and start its journal */
+static void begin_play(UI*ui,Journal*j,Game*g){
+  ui->screen=SCR_PLAY; ui->start_t=now_s(); ui->paused=false; ui->paused_accum=0; ui->mistakes=0; ui->strikes=0;
+  if(ui->auto_notes) game_fill_notes(g);
+  journal_begin(j,g,ui);
+}
+
 int main(int argc,char**argv){
-  const char* font_cli=NULL;
+  const char* font_cli=NULL; const char* val; const char* trace_path=NULL;
+  long gen_count=0; int gen_threads=0; uint64_t gen_seed=(uint64_t)time(NULL);
+  const char* pack_path=NULL; const char* pack_out=NULL; const char* pack_verify=NULL;
+  const char* solve_in=NULL; const char* count_in=NULL; int count_max=1000000; bool dedup=false; int box=3, fps_cap=60;
+  Core core; core_init(&core);
   for(int i=1;i<argc;i++){
     if(!strcmp(argv[i],"--font") && i+1<argc){ font_cli=argv[++i]; }
+    else if((val=arg_value("--solver",argc,argv,&i))){
+      if(!solver_select(&core,val)){ fprintf(stderr,"Unknown solver '%s' (use backtrack or dlx)\n", val); return 1; }
+    }
+    else if((val=arg_value("--simd",argc,argv,&i))){
+      if(!simd_select(&core,val)){ fprintf(stderr,"SIMD kernel '%s' unknown or unsupported by this CPU (auto, scalar, sse41, avx2)\n", val); return 1; }
+    }
+    else if((val=arg_value("--difficulty",argc,argv,&i))){
+      if(!parse_band(val,&core.band)){ fprintf(stderr,"Unknown difficulty '%s' (easy, medium, hard, expert, extreme or a range like medium-hard)\n", val); return 1; }
+    }
+    else if(!strncmp(argv[i],"--solve",7) && (argv[i][7]==0 || argv[i][7]=='=')){   /* optional FILE, default stdin */
+      solve_in = argv[i][7]=='='? argv[i]+8 : (i+1<argc && argv[i+1][0]!='-')? argv[++i] : "-";
+    }
+    else if(!strncmp(argv[i],"--count",7) && (argv[i][7]==0 || argv[i][7]=='=')){   /* optional FILE, default stdin */
+      count_in = argv[i][7]=='='? argv[i]+8 : (i+1<argc && argv[i+1][0]!='-')? argv[++i] : "-";
+    }
+    else if((val=arg_value("--limit",argc,argv,&i))) count_max=atoi(val);
+    else if((val=arg_value("--generate",argc,argv,&i))) gen_count=atol(val);
+    else if(!strcmp(argv[i],"--dedup")) dedup=true;
+    else if(!strcmp(argv[i],"--minimal")) core.minimal=true;
+    else if((val=arg_value("--size",argc,argv,&i))){   /* 4, 9, 16 or 25 (or 4x4, ...) */
+      int n=atoi(val); box = n==4?2 : n==9?3 : n==16?4 : n==25?5 : 0;
+      if(!valid_box(box)){ fprintf(stderr,"Unknown board size '%s' (4, 9, 16 or 25)\n", val); return 1; }
+    }
+    else if((val=arg_value("--threads",argc,argv,&i))) gen_threads=atoi(val);
+    else if((val=arg_value("--fps",argc,argv,&i))) fps_cap=atoi(val);
+    else if((val=arg_value("--trace",argc,argv,&i))) trace_path=val;
+    else if((val=arg_value("--seed",argc,argv,&i))) gen_seed=strtoull(val,NULL,10);
+    else if((val=arg_value("--pack-out",argc,argv,&i))) pack_out=val;
+    else if((val=arg_value("--verify-pack",argc,argv,&i))) pack_verify=val;
+    else if((val=arg_value("--pack",argc,argv,&i))) pack_path=val;
+  }
+
+  /* headless modes: no window, no SDL */
+  if(pack_verify){ int rc=run_verify_pack(&core,pack_verify); core_free(&core); return rc; }
+  if(solve_in){ int rc=run_solve(&core,solve_in,gen_threads,stdout); core_free(&core); return rc; }
+  if(count_in){ int rc=run_count(&core,count_in,gen_threads,count_max,stdout); core_free(&core); return rc; }
+  /* minimal digging probes clues on the cores the generators leave idle (none for a full batch) */
+  Pool pool; pool_start(&pool, core.minimal? cpu_count()-(gen_count>0? (gen_threads>0? gen_threads : cpu_count()) : 1) : 0);
+  core.parallel_for=pool_for; core.pool=&pool;
+  if(gen_count>0){ int rc=run_generate(&core,gen_count,gen_threads,gen_seed,dedup,stdout,pack_out); pool_stop(&pool); core_free(&core); return rc; }
+  if(pack_path){
+    char err[256]; core.pack=pack_open(pack_path,err,sizeof(err));
+    if(!core.pack){ fprintf(stderr,"%s\n",err); return 1; }
   }
 
   SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
@@ -830,27 +1934,64 @@ int main(int argc,char**argv){
 
   g.font_big   = TTF_OpenFont(fpath, 44);
   g.font_small = TTF_OpenFont(fpath, 20);
+  if((!g.font_big || !g.font_small) && !font_cli){
+    /* the header looked fine but FreeType refused it: forget the cache, retry with full opens */
+    if(g.font_big) TTF_CloseFont(g.font_big);
+    if(g.font_small) TTF_CloseFont(g.font_small);
+    g.font_big=g.font_small=NULL;
+    font_cache_clear(); font_full_open=true;
+    fpath=find_font_path_dynamic(font_path, NULL);
+    if(fpath){ g.font_big=TTF_OpenFont(fpath, 44); g.font_small=TTF_OpenFont(fpath, 20); }
+  }
   if(!g.font_big || !g.font_small){
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Sudokura v1.0","TTF_OpenFont failed with the chosen font.", g.win);
     return 1;
   }
-
-  Game game; new_game(&game,(unsigned)time(NULL));
+  if(!atlas_build(&g)) fprintf(stderr,"glyph atlas: %s\n", SDL_GetError());
+  g.targets = SDL_RenderTargetSupported(g.ren);
+  if(!prof_init(&g.prof,trace_path)) fprintf(stderr,"--trace: cannot write %s\n", trace_path);
 
   UI ui; memset(&ui,0,sizeof(ui));
-  ui.sel_r=4; ui.sel_c=4; ui.dark_theme=true; ui.mode=MODE_CLASSIC; ui.screen=SCR_TITLE; ui.prev_screen=SCR_TITLE;
+  ui.box=box; ui.sel_r=ui.sel_c=box*box/2; ui.dark_theme=true; ui.mode=MODE_CLASSIC; ui.screen=SCR_TITLE; ui.prev_screen=SCR_TITLE;
   set_mode_params(&ui);
 
-  bool running=true; SDL_Event e;
+  /* an interrupted game is resumed from its journal, otherwise start on the title screen */
+  Journal jr; memset(&jr,0,sizeof(jr)); pref_file("game.journal",jr.path);
+  Game game; bool have_game=journal_resume(&jr,&game,&ui);
+  Prefetch pf; prefetch_start(&pf,&core,ui.box,(uint64_t)time(NULL));
+  if(have_game) show_toast(&ui,"Game resumed");   /* else the first game is popped on Start */
+
+  /* redraw on input or when next_redraw_due says so, at most fps_cap times a second (0 = vsync only) */
+  bool running=true, dirty=true, focused=true; SDL_Event e;
+  const double min_frame = fps_cap>0? 1.0/fps_cap : 0.0;
+  double last_frame=-1.0, due=0.0;
   while(running){
-    while(SDL_PollEvent(&e)){
+    if(have_game) clamp_selection(&ui,&game);
+    double now=now_s(), wake = dirty? last_frame+min_frame : due;
+    int wait_ms = wake>now? (int)((wake-now)*1000.0+0.5) : 0;
+    bool have = wait_ms>0? SDL_WaitEventTimeout(&e,wait_ms)!=0 : SDL_PollEvent(&e)!=0;
+    const bool polled=have;
+    if(polled) prof_begin(&g.prof,PH_EVENTS);
+    for(; have; have=SDL_PollEvent(&e)!=0){
+      dirty=true;
+      if(e.type==SDL_KEYDOWN) prof_input(&g.prof,e.key.timestamp);
+      else if(e.type==SDL_MOUSEBUTTONDOWN) prof_input(&g.prof,e.button.timestamp);
       if(e.type==SDL_QUIT) running=false;
       else if(e.type==SDL_WINDOWEVENT && e.window.event==SDL_WINDOWEVENT_SIZE_CHANGED){ g.width=e.window.data1; g.height=e.window.data2; }
+      else if(e.type==SDL_WINDOWEVENT && (e.window.event==SDL_WINDOWEVENT_FOCUS_GAINED || e.window.event==SDL_WINDOWEVENT_FOCUS_LOST))
+        focused = e.window.event==SDL_WINDOWEVENT_FOCUS_GAINED;
+      else if(e.type==SDL_RENDER_TARGETS_RESET) layers_invalidate(&g);
+      else if(e.type==SDL_RENDER_DEVICE_RESET){ gfx_drop_caches(&g); atlas_build(&g); }
       else if(e.type==SDL_KEYDOWN){
         SDL_Keycode k=e.key.keysym.sym;
-        if(ui.screen==SCR_TITLE){
+        if(k==SDLK_F3) g.prof.hud=!g.prof.hud;
+        else if(ui.screen==SCR_TITLE){
           if(k==SDLK_ESCAPE) running=false;
-          else if(k==SDLK_RETURN){ ui.screen=SCR_PLAY; ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0; }
+          else if(k==SDLK_RETURN){
+            if(!have_game || game.box!=ui.box) ui.starting=true;
+            else begin_play(&ui,&jr,&game);
+          }
+          else if(k==SDLK_z){ ui.box = ui.box==MAX_BOX? 2 : ui.box+1; prefetch_resize(&pf,ui.box); }
           else if(k==SDLK_t) ui.dark_theme=!ui.dark_theme;
           else if(k==SDLK_F1){ ui.prev_screen=SCR_TITLE; ui.screen=SCR_HELP; }
           else if(k==SDLK_F2){ ui.prev_screen=SCR_TITLE; ui.screen=SCR_ABOUT; }
@@ -858,32 +1999,47 @@ int main(int argc,char**argv){
         } else if(ui.screen==SCR_HELP || ui.screen==SCR_ABOUT){
           if(k==SDLK_ESCAPE) ui.screen=ui.prev_screen;
         } else if(ui.screen==SCR_END){
-          if(k==SDLK_ESCAPE) ui.screen=SCR_TITLE;
-          else if(k==SDLK_RETURN){
-            new_game(&game,(unsigned)time(NULL));
-            ui.screen=SCR_PLAY; ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0;
-          }
+          if(k==SDLK_ESCAPE){ ui.screen=SCR_TITLE; ui.starting=false; }
+          else if(k==SDLK_RETURN) ui.starting=true;
         } else { /* PLAY */
           bool shifted=(SDL_GetModState()&KMOD_SHIFT)!=0;
-          int r=ui.sel_r, c=ui.sel_c, i=IDX(r,c);
-          if(k==SDLK_ESCAPE) ui.screen=SCR_TITLE;
-          else if(k==SDLK_UP||k==SDLK_w) ui.sel_r=(ui.sel_r+8)%9;
-          else if(k==SDLK_DOWN||k==SDLK_s) ui.sel_r=(ui.sel_r+1)%9;
-          else if(k==SDLK_LEFT||k==SDLK_a) ui.sel_c=(ui.sel_c+8)%9;
-          else if(k==SDLK_RIGHT||k==SDLK_d) ui.sel_c=(ui.sel_c+1)%9;
-          else if(k==SDLK_p){ if(!ui.paused){ ui.paused=true; ui.pause_t0=now_s(); } else { ui.paused=false; ui.paused_accum += now_s()-ui.pause_t0; } }
+          bool ctrl=(SDL_GetModState()&KMOD_CTRL)!=0;
+          int n=game.side, r=ui.sel_r, c=ui.sel_c, i=GIDX(&game,r,c);
+          if(k==SDLK_ESCAPE){ ui.screen=SCR_TITLE; ui.starting=false; }
+          else if(ctrl && (k==SDLK_z || k==SDLK_y)){ /* Ctrl+Z undo, Ctrl+Y / Ctrl+Shift+Z redo */
+            bool redo = k==SDLK_y || shifted;
+            if(!(redo? journal_redo(&jr,&game,&ui) : journal_undo(&jr,&game,&ui))) show_toast(&ui, redo?"Nothing to redo":"Nothing to undo");
+          }
+          else if(ctrl && k>=SDLK_a && k<SDLK_a+n-9){ /* 10+ on the 16x16 / 25x25 boards: Ctrl+A = 10 */
+            int v=10+(int)(k-SDLK_a);
+            if(ui.notes_mode || shifted) play_note(&jr,&game,&ui,i,v);
+            else if(!play_place(&jr,&game,&ui,r,c,v, ui.strict_mode) || v!=game.solution[i]){
+              if(v!=game.solution[i]){ ui.mistakes++; if(ui.mode==MODE_STRIKES) ui.strikes++; show_toast(&ui, game.puzzle[i]==v?"Wrong":"Illegal"); }
+            }
+          }
+          else if(k==SDLK_UP||k==SDLK_w) ui.sel_r=(ui.sel_r+n-1)%n;
+          else if(k==SDLK_DOWN||k==SDLK_s) ui.sel_r=(ui.sel_r+1)%n;
+          else if(k==SDLK_LEFT||k==SDLK_a) ui.sel_c=(ui.sel_c+n-1)%n;
+          else if(k==SDLK_RIGHT||k==SDLK_d) ui.sel_c=(ui.sel_c+1)%n;
+          else if(k==SDLK_p){ if(!ui.paused){ ui.paused=true; ui.pause_t0=now_s(); } else { ui.paused=false; ui.paused_accum += now_s()-ui.pause_t0; } journal_stats(&jr,&game,&ui,true); }
           else if(k==SDLK_t) ui.dark_theme=!ui.dark_theme;
           else if(k==SDLK_n){ ui.notes_mode=!ui.notes_mode; show_toast(&ui, ui.notes_mode?"Notes ON":"Notes OFF"); }
           else if(k==SDLK_m){ ui.strict_mode=!ui.strict_mode; show_toast(&ui, ui.strict_mode?"Strict":"Free"); }
-          else if(k==SDLK_h){ if(give_hint(&game,r,c)) show_toast(&ui,"Hint used"); }
+          else if(k==SDLK_c){
+            ui.auto_notes=!ui.auto_notes; if(ui.auto_notes) play_fill_notes(&jr,&game,&ui);
+            journal_checkpoint(&jr,&game,&ui);   /* the flags live in checkpoints */
+            show_toast(&ui, ui.auto_notes?"Auto-notes ON":"Auto-notes OFF");
+          }
+          else if(k==SDLK_x){ ui.auto_prune=!ui.auto_prune; journal_checkpoint(&jr,&game,&ui); show_toast(&ui, ui.auto_prune?"Auto-prune ON":"Auto-prune OFF"); }
+          else if(k==SDLK_h){ if(play_hint(&jr,&game,&ui,r,c)) show_toast(&ui,"Hint used"); }
           else if(k==SDLK_DELETE || k==SDLK_BACKSPACE || k==SDLK_0 || k==SDLK_KP_0){
-            if(!game.fixed[i]){ game.puzzle[i]=0; game.notes[i]=0; }
+            play_place(&jr,&game,&ui,r,c,0,false);
           } else {
             int v=0; if(k>=SDLK_1 && k<=SDLK_9) v=(k-SDLK_0); else if(k>=SDLK_KP_1 && k<=SDLK_KP_9) v=(k-SDLK_KP_0);
-            if(v>=1 && v<=9){
-              if(ui.notes_mode || shifted){ if(!game.fixed[i] && game.puzzle[i]==0) game.notes[i]^=(1u<<v); }
+            if(v>=1 && v<=9 && v<=n){
+              if(ui.notes_mode || shifted) play_note(&jr,&game,&ui,i,v);
               else{
-                if(place(&game,r,c,v, ui.strict_mode)){
+                if(play_place(&jr,&game,&ui,r,c,v, ui.strict_mode)){
                   if(v!=game.solution[i]){ ui.mistakes++; if(ui.mode==MODE_STRIKES) ui.strikes++; show_toast(&ui,"Wrong"); }
                 } else {
                   if(v!=game.solution[i]){ ui.mistakes++; if(ui.mode==MODE_STRIKES) ui.strikes++; show_toast(&ui,"Illegal"); }
@@ -898,41 +2054,46 @@ int main(int argc,char**argv){
 
         if(ui.screen==SCR_TITLE){
           int bx=g.width/2-180, by=g.height/2-60, bw=360, bh=42, gap=12;
-          SDL_Rect r_mode={bx,by,bw,bh}; by+=bh+gap; SDL_Rect r_start={bx,by,bw,bh}; by+=bh+gap;
+          SDL_Rect r_mode={bx,by,bw,bh}; by+=bh+gap; SDL_Rect r_size={bx,by,bw,bh}; by+=bh+gap; SDL_Rect r_start={bx,by,bw,bh}; by+=bh+gap;
           SDL_Rect r_help={bx,by,bw,bh}; by+=bh+gap; SDL_Rect r_about={bx,by,bw,bh}; by+=bh+gap; SDL_Rect r_quit={bx,by,bw,bh};
           if(point_in(r_mode,x,y)){ ui.mode=(ui.mode+1)%3; set_mode_params(&ui); }
-          else if(point_in(r_start,x,y)){ ui.screen=SCR_PLAY; ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0; }
+          else if(point_in(r_size,x,y)){ ui.box = ui.box==MAX_BOX? 2 : ui.box+1; prefetch_resize(&pf,ui.box); }
+          else if(point_in(r_start,x,y)){
+            if(!have_game || game.box!=ui.box) ui.starting=true;
+            else begin_play(&ui,&jr,&game);
+          }
           else if(point_in(r_help,x,y)){ ui.prev_screen=SCR_TITLE; ui.screen=SCR_HELP; }
           else if(point_in(r_about,x,y)){ ui.prev_screen=SCR_TITLE; ui.screen=SCR_ABOUT; }
-          else if(point_in(r_quit,x,y)) return 0;
+          else if(point_in(r_quit,x,y)) running=false;
         } else if(ui.screen==SCR_END){
           int bx=g.width/2-160, by=260, bw=320, bh=40, gap=12;
           SDL_Rect b1={bx,by,bw,bh}; by+=bh+gap; SDL_Rect b2={bx,by,bw,bh};
-          if(point_in(b1,x,y)){ new_game(&game,(unsigned)time(NULL)); ui.screen=SCR_PLAY; ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0; }
-          else if(point_in(b2,x,y)) ui.screen=SCR_TITLE;
+          if(point_in(b1,x,y)) ui.starting=true;
+          else if(point_in(b2,x,y)){ ui.screen=SCR_TITLE; ui.starting=false; }
         } else if(ui.screen==SCR_HELP || ui.screen==SCR_ABOUT){
           Theme th = ui.dark_theme?theme_dark():theme_light();
           (void)th;
           SDL_Rect r = back_rect(&g);
           if(point_in(r, x,y)) ui.screen=ui.prev_screen;
         } else {
-          Layout L = compute_layout(g.width,g.height);
-          int gx=L.board.x, gy=L.board.y, side=L.board.w, cs=side/9;
+          const int n=game.side, bx=game.box;
+          Layout L = compute_layout(g.width,g.height,n);
+          int gx=L.board.x, gy=L.board.y, side=L.board.w, cs=side/n;
           if(x>=gx && x<gx+side && y>=gy && y<gy+side){
             int c=(x-gx)/cs, r=(y-gy)/cs; ui.sel_r=r; ui.sel_c=c;
-            int i=IDX(r,c);
-            if(!game.fixed[i]){
+            int i=GIDX(&game,r,c);
+            if(!game_fixed(&game,i)){
               int lx=x-(gx+c*cs), ly=y-(gy+r*cs);
-              int sub=cs/3, qq=lx/sub, q=ly/sub; if(qq<0) qq=0; if(q<0) q=0; if(qq>2) qq=2; if(q>2) q=2;
-              int vv=q*3+qq+1;
-              if(right || ui.notes_mode){ if(game.puzzle[i]==0) game.notes[i]^=(1u<<vv); }
+              int sub=cs/bx, qq=lx/sub, q=ly/sub; if(qq<0) qq=0; if(q<0) q=0; if(qq>bx-1) qq=bx-1; if(q>bx-1) q=bx-1;
+              int vv=q*bx+qq+1;
+              if(right || ui.notes_mode) play_note(&jr,&game,&ui,i,vv);
             }
           }else{
-            SidebarRects R; compute_sidebar_rects(&L, &ui, &R);
+            SidebarRects R; compute_sidebar_rects(&L, &ui, &game, &R);
 
             if(point_in(R.btn[0],x,y)){ /* New */
               if(confirm_box(g.win,"New game","Start a new game? Current progress will be lost.","New")){
-                new_game(&game,(unsigned)time(NULL)); ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0;
+                ui.starting=true;
               }
             }
             else if(point_in(R.btn[1],x,y)){ /* Mode */
@@ -940,23 +2101,23 @@ int main(int argc,char**argv){
               char msg[128]; snprintf(msg,sizeof(msg),"Change mode to %s?\nThis will start a new game.", next);
               if(confirm_box(g.win,"Change mode",msg,"Change")){
                 ui.mode = (ui.mode+1)%3; set_mode_params(&ui);
-                new_game(&game,(unsigned)time(NULL)); ui.start_t=now_s(); ui.paused=false; ui.paused_accum=0; ui.mistakes=0; ui.strikes=0;
+                ui.starting=true;
               }
             }
-            else if(point_in(R.btn[2],x,y)){ if(give_hint(&game,ui.sel_r,ui.sel_c)) show_toast(&ui,"Hint used"); } /* Hint */
+            else if(point_in(R.btn[2],x,y)){ if(play_hint(&jr,&game,&ui,ui.sel_r,ui.sel_c)) show_toast(&ui,"Hint used"); } /* Hint */
             else if(point_in(R.btn[3],x,y)){ ui.notes_mode=!ui.notes_mode; show_toast(&ui, ui.notes_mode?"Notes ON":"Notes OFF"); }
             else if(point_in(R.btn[4],x,y)){ int conf=count_conflicts(&game); if(conf==0) show_toast(&ui,"No conflicts"); else { char m[32]; snprintf(m,sizeof(m),"Conflicts: %d",conf); show_toast(&ui,m);} }
             else if(point_in(R.btn[5],x,y)){ ui.dark_theme=!ui.dark_theme; }
             else if(point_in(R.btn[6],x,y)){ ui.prev_screen=SCR_PLAY; ui.screen=SCR_HELP; }
             else if(point_in(R.btn[7],x,y)){ ui.prev_screen=SCR_PLAY; ui.screen=SCR_ABOUT; }
-            else if(point_in(R.btn[8],x,y)){ ui.screen=SCR_TITLE; }
+            else if(point_in(R.btn[8],x,y)){ ui.screen=SCR_TITLE; ui.starting=false; }
             else{
-              for(int n=1;n<=9;n++) if(point_in(R.pal[n-1],x,y)){
-                int i=IDX(ui.sel_r,ui.sel_c);
-                if(!game.fixed[i]){
-                  if(ui.notes_mode){ if(game.puzzle[i]==0) game.notes[i]^=(1u<<n); }
+              for(int n=1;n<=R.count_pal;n++) if(point_in(R.pal[n-1],x,y)){
+                int i=GIDX(&game,ui.sel_r,ui.sel_c);
+                if(!game_fixed(&game,i)){
+                  if(ui.notes_mode) play_note(&jr,&game,&ui,i,n);
                   else{
-                    if(place(&game,ui.sel_r,ui.sel_c,n, ui.strict_mode)){
+                    if(play_place(&jr,&game,&ui,ui.sel_r,ui.sel_c,n, ui.strict_mode)){
                       if(n!=game.solution[i]){ ui.mistakes++; if(ui.mode==MODE_STRIKES) ui.strikes++; show_toast(&ui,"Wrong"); }
                     }else{
                       if(n!=game.solution[i]){ ui.mistakes++; if(ui.mode==MODE_STRIKES) ui.strikes++; show_toast(&ui,"Illegal"); }
@@ -969,25 +2130,52 @@ int main(int argc,char**argv){
         }
       }
     }
+    if(polled) prof_end(&g.prof,PH_EVENTS);
+    if(ui.starting && next_game(&pf,&game)){
+      ui.starting=false; have_game=true; dirty=true;
+      clamp_selection(&ui,&game); begin_play(&ui,&jr,&game);
+    }
 
     /* win/lose checks */
+    prof_begin(&g.prof,PH_LOGIC);
     if(ui.screen==SCR_PLAY && !ui.paused){
       bool lose=false;
       if(ui.mode==MODE_TIME && ui.time_limit_s>0 && elapsed_time(&ui)>ui.time_limit_s) lose=true;
       if(ui.mode==MODE_STRIKES && ui.strikes>=ui.strikes_max) lose=true;
       if(is_solved(&game)){ ui.result=RES_WIN; ui.screen=SCR_END; }
       else if(lose){ ui.result=RES_LOSE; ui.screen=SCR_END; }
+      if(ui.screen==SCR_END) journal_end(&jr); else journal_stats(&jr,&game,&ui,false);
     }
+    prof_end(&g.prof,PH_LOGIC);
 
+    now=now_s();
+    if(dirty? now<last_frame+min_frame : now<due) continue;
+    if(have_game) clamp_selection(&ui,&game);
+    prof_begin(&g.prof,PH_SCREEN);
     if(ui.screen==SCR_TITLE) render_title(&g,&ui);
     else if(ui.screen==SCR_HELP) render_help(&g,&ui);
     else if(ui.screen==SCR_ABOUT) render_about(&g,&ui);
     else if(ui.screen==SCR_END) render_end(&g,&ui);
     else render_board_and_sidebar(&g,&game,&ui);
+    if(ui.starting) render_generating(&g,&ui);
+    prof_end(&g.prof,PH_SCREEN);
+    if(g.prof.hud) render_prof_hud(&g);
 
+    prof_begin(&g.prof,PH_PRESENT);
     SDL_RenderPresent(g.ren);
+    prof_end(&g.prof,PH_PRESENT);
+    prof_frame_done(&g.prof);
+    last_frame=now; dirty=false; due=next_redraw_due(&ui,now_s(),focused);
+    if(g.prof.hud && due>now+0.25) due=now+0.25;
   }
 
+  if(ui.screen==SCR_PLAY) journal_stats(&jr,&game,&ui,true);
+  journal_close(&jr);
+  prefetch_stop(&pf);
+  pool_stop(&pool);
+  core_free(&core);
+  prof_close(&g.prof);
+  gfx_drop_caches(&g); atlas_free(&g); free(g.batch.v); free(g.batch.idx);
   if(g.font_big) TTF_CloseFont(g.font_big);
   if(g.font_small) TTF_CloseFont(g.font_small);
   SDL_DestroyRenderer(g.ren); SDL_DestroyWindow(g.win);
@@ -0,0 +1,151 @@
+/*  Sudokura sized board engine — included once per box size by sudokura_core.h for the boards
+    other than 9x9 (which keeps its SIMD / DLX / grader path). Define before including:
+      SZ_BOX    box side (2, 4, 5); the board is SZ_BOX^2 x SZ_BOX^2
+      SZ_MASK   unsigned type with SZ_BOX^2+1 bits (bit v = digit v): uint16_t up to 9x9, uint32_t above
+      SZ(name)  name mangling, e.g. name##_16
+    Sizes, loop bounds and mask width are compile-time constants in every instantiation.
+    Generation never needs a full search: clues are dug while the puzzle stays solvable by naked
+    and hidden singles (which proves uniqueness), then a few more go under a node-budgeted search.
+    License: GPLv3
+*/
+#define SZ_SIDE  (SZ_BOX*SZ_BOX)
+#define SZ_CELLS (SZ_SIDE*SZ_SIDE)
+#define SZ_ALL   ((SZ_MASK)((((SZ_MASK)1<<SZ_SIDE)-1)<<1))
+#define SZ_PROBE_NODES 16   /* budget per extra-dig uniqueness probe; exhausted = keep the clue */
+
+typedef struct {
+  SZ_MASK row[SZ_SIDE], col[SZ_SIDE], box[SZ_SIDE];
+  uint8_t cell[SZ_CELLS];
+  int filled;
+} SZ(Board);
+
+static inline int SZ(box_of)(int i){ int r=i/SZ_SIDE, c=i%SZ_SIDE; return (r/SZ_BOX)*SZ_BOX + c/SZ_BOX; }
+/* cell k of unit u: rows, then columns, then boxes */
+static inline int SZ(unit_cell)(int u,int k){
+  if(u<SZ_SIDE) return u*SZ_SIDE + k;
+  if(u<2*SZ_SIDE) return k*SZ_SIDE + (u-SZ_SIDE);
+  int b=u-2*SZ_SIDE; return ((b/SZ_BOX)*SZ_BOX + k/SZ_BOX)*SZ_SIDE + (b%SZ_BOX)*SZ_BOX + k%SZ_BOX;
+}
+static inline SZ_MASK SZ(cand)(const SZ(Board)*b,int i){
+  return (SZ_MASK)(SZ_ALL & ~(b->row[i/SZ_SIDE]|b->col[i%SZ_SIDE]|b->box[SZ(box_of)(i)]));
+}
+static inline void SZ(set)(SZ(Board)*b,int i,int v){
+  SZ_MASK m=(SZ_MASK)((SZ_MASK)1<<v);
+  b->cell[i]=(uint8_t)v; b->row[i/SZ_SIDE]|=m; b->col[i%SZ_SIDE]|=m; b->box[SZ(box_of)(i)]|=m; b->filled++;
+}
+static bool SZ(load)(SZ(Board)*b,const uint8_t*grid){
+  memset(b,0,sizeof(*b));
+  for(int i=0;i<SZ_CELLS;i++){
+    int v=grid[i]; if(!v) continue;
+    if(v<1 || v>SZ_SIDE || !(SZ(cand)(b,i)>>v&1)) return false;
+    SZ(set)(b,i,v);
+  }
+  return true;
+}
+static int SZ(find_mrv)(const SZ(Board)*b,SZ_MASK*cand){
+  int best=-1, bc=SZ_SIDE+1; SZ_MASK bm=0;
+  for(int i=0;i<SZ_CELLS;i++){
+    if(b->cell[i]) continue;
+    SZ_MASK m=SZ(cand)(b,i); int n=popcnt32(m);
+    if(n<bc){ bc=n; best=i; bm=m; if(n<=2) break; }   /* after propagation nothing has fewer than 2 */
+  }
+  *cand=bm; return best;
+}
+
+/* naked + hidden singles to a fixpoint: -1 contradiction, 1 solved, 0 stuck */
+static int SZ(propagate)(SZ(Board)*b){
+  for(;;){
+    bool moved=false;
+    for(int i=0;i<SZ_CELLS;i++){
+      if(b->cell[i]) continue;
+      SZ_MASK m=SZ(cand)(b,i); if(!m) return -1;
+      if(!(m&(m-1))){ SZ(set)(b,i,lowbit32(m)); moved=true; }
+    }
+    for(int u=0;u<3*SZ_SIDE;u++){
+      SZ_MASK once=0, twice=0, placed=0;
+      for(int k=0;k<SZ_SIDE;k++){
+        int i=SZ(unit_cell)(u,k);
+        if(b->cell[i]) placed|=(SZ_MASK)((SZ_MASK)1<<b->cell[i]);
+        else{ SZ_MASK m=SZ(cand)(b,i); twice|=once&m; once|=m; }
+      }
+      if((SZ_MASK)(once|placed)!=SZ_ALL) return -1;   /* some digit has no place left */
+      for(SZ_MASK hid=(SZ_MASK)(once&~twice); hid; hid&=hid-1){
+        int v=lowbit32(hid);
+        for(int k=0;k<SZ_SIDE;k++){ int i=SZ(unit_cell)(u,k); if(!b->cell[i] && SZ(cand)(b,i)>>v&1){ SZ(set)(b,i,v); moved=true; break; } }
+      }
+    }
+    if(b->filled==SZ_CELLS) return 1;
+    if(!moved) return 0;
+  }
+}
+
+/* solutions up to limit (first one to first, may be NULL); b is scratch. Each node copies the
+   board and propagates; when *budget runs out the answer is limit, i.e. "not unique". */
+static int SZ(count)(SZ(Board)*b,int limit,uint8_t*first,long*budget){
+  if(--*budget<0) return limit;
+  int st=SZ(propagate)(b);
+  if(st<0) return 0;
+  if(st>0){ if(first) memcpy(first,b->cell,SZ_CELLS); return 1; }
+  SZ_MASK m; int i=SZ(find_mrv)(b,&m), tot=0;
+  for(; m; m&=m-1){
+    SZ(Board) c=*b; SZ(set)(&c,i,lowbit32(m));
+    tot+=SZ(count)(&c,limit-tot,tot?NULL:first,budget);
+    if(tot>=limit) break;
+  }
+  return tot;
+}
+
+/* solved grid: base pattern with shuffled bands, stacks, rows, columns and digits */
+static void SZ(make_solved)(Rng*rng,uint8_t*out){
+  int rows[SZ_SIDE], cols[SZ_SIDE], nums[SZ_SIDE], band[SZ_BOX], in[SZ_BOX];
+  for(int i=0;i<SZ_SIDE;i++) nums[i]=i+1;
+  shuffle(rng,nums,SZ_SIDE);
+  for(int pass=0;pass<2;pass++){
+    int* dst=pass? cols : rows, p=0;
+    for(int k=0;k<SZ_BOX;k++) band[k]=k;
+    shuffle(rng,band,SZ_BOX);
+    for(int k=0;k<SZ_BOX;k++){
+      for(int j=0;j<SZ_BOX;j++) in[j]=j;
+      shuffle(rng,in,SZ_BOX);
+      for(int j=0;j<SZ_BOX;j++) dst[p++]=band[k]*SZ_BOX+in[j];
+    }
+  }
+  for(int r=0;r<SZ_SIDE;r++) for(int c=0;c<SZ_SIDE;c++){
+    int r2=rows[r], c2=cols[c];
+    out[r*SZ_SIDE+c]=(uint8_t)nums[(r2*SZ_BOX + r2/SZ_BOX + c2) % SZ_SIDE];
+  }
+}
+
+/* clue pairs (i, mirror of i) in shuffled order; grid must be solved on entry */
+static void SZ(dig)(Rng*rng,uint8_t*grid){
+  uint8_t sol[SZ_CELLS]; int pos[SZ_CELLS]; SZ(Board) b;
+  memcpy(sol,grid,sizeof(sol));
+  for(int i=0;i<SZ_CELLS;i++) pos[i]=i;
+  for(int pass=0;pass<2;pass++){
+    shuffle(rng,pos,SZ_CELLS);
+    for(int k=0;k<SZ_CELLS;k++){
+      int i=pos[k], j=SZ_CELLS-1-i;
+      if(!grid[i] || j<i) continue;
+      grid[i]=grid[j]=0;
+      bool ok;
+      if(!SZ(load)(&b,grid)) ok=false;
+      else if(!pass) ok=SZ(propagate)(&b)>0;
+      else{ long budget=SZ_PROBE_NODES; ok=SZ(count)(&b,2,NULL,&budget)==1; }
+      if(!ok){ grid[i]=sol[i]; grid[j]=sol[j]; }
+    }
+  }
+}
+
+static void SZ(generate)(Rng*rng,uint8_t*puzzle,uint8_t*solution){
+  SZ(make_solved)(rng,solution);
+  memcpy(puzzle,solution,SZ_CELLS);
+  SZ(dig)(rng,puzzle);
+}
+
+#undef SZ_PROBE_NODES
+#undef SZ_ALL
+#undef SZ_CELLS
+#undef SZ_SIDE
+#undef SZ
+#undef SZ_MASK
+#undef SZ_BOX